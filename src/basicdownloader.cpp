@@ -97,6 +97,20 @@ basicdownloader::basicdownloader( const Context& ctx ) :
 		this->appQuit() ;
 	} ) ;
 
+	connect( m_ui.pbCancel,&QPushButton::clicked,[ this ](){
+
+		/*
+		 * A download still waiting for a free slot has no process to
+		 * terminate, dropping it is all there is to do.
+		 */
+		if( m_ctx.Scheduler().cancel( scheduler::queue::basic ) ){
+
+			m_ui.pbCancel->setEnabled( false ) ;
+
+			m_tabManager.setDownloading( tabManager::tab::basic,false ) ;
+		}
+	} ) ;
+
 	auto s = static_cast< void( QComboBox::* )( int ) >( &QComboBox::activated ) ;
 
 	connect( m_ui.cbEngineType,s,[ & ]( int s ){
@@ -215,6 +229,10 @@ void basicdownloader::resetMenu( const QStringList& args )
 		}else if( ac.openFolderPath() ){
 
 			utility::openDownloadFolderPath( m_settings.downloadFolder() ) ;
+
+		}else if( ac.clearMetadataCache() ){
+
+			m_ctx.MetadataCache().clear() ;
 		}else{
 			m_ui.lineEditOptions->setText( ac.objectName() ) ;
 
@@ -259,12 +277,7 @@ void basicdownloader::setDefaultEngine()
 
 void basicdownloader::tabManagerEnableAll( bool e )
 {
-	if( e ){
-
-		m_tabManager.enableAll() ;
-	}else{
-		m_tabManager.disableAll() ;
-	}
+	m_tabManager.setDownloading( tabManager::tab::basic,!e ) ;
 }
 
 void basicdownloader::retranslateUi()
@@ -318,7 +331,11 @@ void basicdownloader::checkAndPrintInstalledVersion( const engines::engine& engi
 		}else{
 			auto& logger = ctx.context.logger() ;
 
-			logger.add( tr( "Found version" ) + ": " + ctx.engine.versionString( ctx.data ) ) ;
+			auto version = ctx.engine.versionString( ctx.data ) ;
+
+			logger.add( tr( "Found version" ) + ": " + version ) ;
+
+			ctx.context.MetadataCache().setEngineVersion( ctx.engine.name(),version ) ;
 
 			if( ctx.context.debug() ){
 
@@ -347,6 +364,28 @@ void basicdownloader::listRequested( const QList< QByteArray >& args )
 		}
 	}
 
+	/*
+	 * Only a list of a single url can be looked up again.
+	 */
+	if( !m_listUrl.contains( ' ' ) ){
+
+		const auto& engine = m_ctx.Engines().defaultEngine() ;
+
+		QStringList m ;
+
+		for( const auto& it : args ){
+
+			m.append( it ) ;
+		}
+
+		m_ctx.MetadataCache().set( metadataCache::kind::formats,engine,m_listUrl,m.join( '\n' ) ) ;
+	}
+
+	this->showList( args ) ;
+}
+
+void basicdownloader::showList( const QList< QByteArray >& args )
+{
 	QStringList opts ;
 
 	QStringList m ;
@@ -406,10 +445,23 @@ void basicdownloader::list()
 
 	const auto& backend = m_ctx.Engines().defaultEngine() ;
 
+	m_listUrl = url.trimmed() ;
+
+	auto formats = m_ctx.MetadataCache().get( metadataCache::kind::formats,backend,m_listUrl ) ;
+
+	if( !formats.isEmpty() ){
+
+		m_ui.pbCancel->setEnabled( false ) ;
+
+		this->showList( formats.toUtf8().split( '\n' ) ) ;
+
+		return ;
+	}
+
 	auto args = backend.defaultListCmdOptions() ;
 	args.append( url.split( ' ' ) ) ;
 
-	this->run( backend,args,"",true ) ;
+	this->run( backend,args,"",true,scheduler::key() ) ;
 }
 
 void basicdownloader::download( const QString& url )
@@ -460,20 +512,41 @@ void basicdownloader::download( const engines::engine& engine,
 
 	auto opts = utility::updateOptions( engine,args,urls ) ;
 
-	this->run( engine,opts,args.quality,false ) ;
+	this->run( engine,opts,args.quality,false,{ engine,urls.value( 0 ) } ) ;
 }
 
 void basicdownloader::run( const engines::engine& engine,
 			   const QStringList& args,
 			   const QString& quality,
-			   bool list_requested )
+			   bool list_requested,
+			   scheduler::key key )
 {
-	utility::run( engine,
-		      args,
-		      quality,
-		      basicdownloader::options( *m_ui.pbCancel,m_ctx,engine,m_bogusTable,m_debug,list_requested ),
-		      LoggerWrapper( m_ctx.logger(),utility::concurrentID() ),
-		      utility::make_term_conn( m_ui.pbCancel,&QPushButton::clicked ) ) ;
+	if( list_requested ){
+
+		utility::run( engine,
+			      args,
+			      quality,
+			      basicdownloader::options( *m_ui.pbCancel,m_ctx,engine,m_bogusTable,m_debug,true,std::move( key ) ),
+			      LoggerWrapper( m_ctx.logger(),utility::concurrentID() ),
+			      utility::make_term_conn( m_ui.pbCancel,&QPushButton::clicked ) ) ;
+	}else{
+		/*
+		 * Downloads share the concurrency limit with the other tabs,
+		 * options::done() gives the slot back. Only this tab is locked
+		 * while the download waits for a slot and runs.
+		 */
+		m_tabManager.setDownloading( tabManager::tab::basic,true ) ;
+
+		m_ctx.Scheduler().submit( scheduler::queue::basic,key,[ this,&engine,args,quality,key ](){
+
+			utility::run( engine,
+				      args,
+				      quality,
+				      basicdownloader::options( *m_ui.pbCancel,m_ctx,engine,m_bogusTable,m_debug,false,key ),
+				      LoggerWrapper( m_ctx.logger(),utility::concurrentID() ),
+				      utility::make_term_conn( m_ui.pbCancel,&QPushButton::clicked ) ) ;
+		} ) ;
+	}
 }
 
 void basicdownloader::updateEngines()
@@ -555,16 +628,16 @@ void basicdownloader::options::done( bool e )
 	concurrentDownloadManagerFinishedStatus s{ 0,false,true,e } ;
 
 	utility::updateFinishedState( m_engine,m_ctx.Settings(),m_table,s ) ;
+
+	if( !m_listRequested ){
+
+		m_ctx.Scheduler().finished( scheduler::queue::basic,m_key ) ;
+	}
 }
 
 basicdownloader::options& basicdownloader::options::tabManagerEnableAll( bool e )
 {
-	if( e ){
-
-		m_ctx.TabManager().enableAll() ;
-	}else{
-		m_ctx.TabManager().disableAll() ;
-	}
+	m_ctx.TabManager().setDownloading( tabManager::tab::basic,!e ) ;
 
 	return *this ;
 }
@@ -27,6 +27,7 @@
 #include "settings.h"
 #include "utility.h"
 #include "context.hpp"
+#include "scheduler.h"
 
 class basicdownloader : public QObject
 {
@@ -56,13 +57,15 @@ private:
 			 const engines::engine& engine,
 			 QTableWidget& table,
 			 bool d,
-			 bool l ) :
+			 bool l,
+			 scheduler::key key ) :
 			m_button( p ),
 			m_ctx( ctx ),
 			m_engine( engine ),
 			m_table( table ),
 			m_debug( d ),
-			m_listRequested( l )
+			m_listRequested( l ),
+			m_key( std::move( key ) )
 		{
 		}
 
@@ -81,6 +84,10 @@ private:
 		{
 			return m_listRequested ;
 		}
+		/*
+		 * A list of formats is a few kilobytes, this is plenty.
+		 */
+		static constexpr int maxCapturedOutputSize = 1024 * 1024 ;
 		bool debug()
 		{
 			return m_debug ;
@@ -100,6 +107,7 @@ private:
 		QTableWidget& m_table ;
 		bool m_debug ;
 		bool m_listRequested ;
+		scheduler::key m_key ;
 	} ;
 
 	size_t m_counter = 0 ;
@@ -109,6 +117,7 @@ private:
 	Ui::MainWindow& m_ui ;
 	tabManager& m_tabManager ;
 	QStringList m_optionsList ;
+	QString m_listUrl ;
 	QTableWidget m_bogusTable ;
 
 	void setDefaultEngine() ;
@@ -116,10 +125,12 @@ private:
 	void run( const engines::engine& engine,
 		  const QStringList& args,
 		  const QString& quality,
-		  bool list_requested ) ;
+		  bool list_requested,
+		  scheduler::key key ) ;
 
 	void tabManagerEnableAll( bool ) ;
 	void listRequested( const QList< QByteArray >& ) ;
+	void showList( const QList< QByteArray >& ) ;
 	void list() ;
 	void download( const engines::engine&,
 		       const utility::args&,
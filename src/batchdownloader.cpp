@@ -20,6 +20,8 @@
 #include "batchdownloader.h"
 #include "tabmanager.h"
 
+#include <QTimer>
+
 batchdownloader::batchdownloader( const Context& ctx ) :
 	m_ctx( ctx ),
 	m_settings( m_ctx.Settings() ),
@@ -31,7 +33,8 @@ batchdownloader::batchdownloader( const Context& ctx ) :
 	m_ccmd( m_ctx,
 		batchdownloader::Index( m_downloadEntries,*m_ui.tableWidgetBD ),
 		*m_ui.lineEditBDUrlOptions,
-		*m_ui.pbBDCancel )
+		*m_ui.pbBDCancel,
+		scheduler::queue::batch )
 {
 	m_ui.tabWidgetBatchDownlader->setCurrentIndex( 0 ) ;
 
@@ -123,6 +126,10 @@ void batchdownloader::resetMenu()
 		}else if( ac.openFolderPath() ){
 
 			utility::openDownloadFolderPath( m_settings.downloadFolder() ) ;
+
+		}else if( ac.clearMetadataCache() ){
+
+			m_ctx.MetadataCache().clear() ;
 		}else{
 			m_ui.lineEditBDUrlOptions->setText( ac.objectName() ) ;
 
@@ -158,6 +165,15 @@ void batchdownloader::download( const engines::engine& engine,
 
 	m_ui.tabWidget->setCurrentIndex( 1 ) ;
 
+	if( m_ccmd.running() ){
+
+		/*
+		 * addToList() already queued them to the running batch, it
+		 * keeps the options it was started with.
+		 */
+		return ;
+	}
+
 	m_ui.tabWidgetBatchDownlader->setCurrentIndex( 0 ) ;
 
 	m_ui.lineEditBDUrlOptions->setText( opts ) ;
@@ -167,6 +183,8 @@ void batchdownloader::download( const engines::engine& engine,
 
 void batchdownloader::clearScreen()
 {
+	m_titleRequests.clear() ;
+
 	utility::clear( *m_ui.tableWidgetBD ) ;
 	m_ui.lineEditBDUrlOptions->clear() ;
 	m_ui.lineEditBDUrl->clear() ;
@@ -183,72 +201,140 @@ static void _set_variables( Ui::MainWindow& ui,const QString& url,const QString&
 	ui.pbBDDownload->setEnabled( true ) ;
 }
 
-template< typename Function >
-static void _getUrlTitle( const QString& exe,const QStringList& args,Function function )
+void batchdownloader::addToList( const QString& a,bool doNotGetTitle )
 {
-	utility::run( exe,args,[]( QProcess& exe ){
+	if( !a.isEmpty() ){
 
-		exe.setProcessChannelMode( QProcess::ProcessChannelMode::SeparateChannels ) ;
+		auto s = concurrentDownloadManagerFinishedStatus::notStarted() ;
 
-		return QString() ;
+		_set_variables( m_ui,a,s,m_mainWindow ) ;
 
-	},[]( QProcess& ){},[ function = std::move( function ) ]( int s,QProcess::ExitStatus e,QString& c ){
+		this->queueNewEntry() ;
 
-			if( s == 0 && e == QProcess::ExitStatus::NormalExit ){
+		const auto& engine = m_ctx.Engines().defaultEngine() ;
 
-				function( c ) ;
-			}else{
-				function( QString() ) ;
+		if( !doNotGetTitle && engine.likeYoutubeDl() ){
+
+			titleRequest request( m_ui.tableWidgetBD->rowCount() - 1,a ) ;
+
+			auto title = m_ctx.MetadataCache().get( metadataCache::kind::title,engine,a ) ;
+
+			if( !title.isEmpty() ){
+
+				this->setTitle( request,title ) ;
+
+				return ;
 			}
 
-	},[]( QProcess::ProcessChannel channel,QByteArray data,QString& c ){
+			m_titleRequests.emplace_back( std::move( request ) ) ;
 
-		if( channel == QProcess::ProcessChannel::StandardOutput ){
+			/*
+			 * Deferred so that urls added together end up in as few
+			 * queries as possible.
+			 */
+			if( !m_titleResolutionPending ){
 
-			c = data ;
+				m_titleResolutionPending = true ;
+
+				QTimer::singleShot( 0,this,[ this ](){
+
+					m_titleResolutionPending = false ;
+
+					this->resolveTitles() ;
+				} ) ;
+			}
 		}
-	} ) ;
+	}
 }
 
-void batchdownloader::addToList( const QString& a,bool doNotGetTitle )
+/*
+ * Titles are fetched a batch of urls per engine process with a few of them
+ * running at once, rows are added right away and get their title when it
+ * arrives so the ui is never held up.
+ */
+void batchdownloader::resolveTitles()
 {
-	if( !a.isEmpty() ){
+	const auto& engine = m_ctx.Engines().defaultEngine() ;
 
-		const auto& engine = m_ctx.Engines().defaultEngine() ;
+	const auto& urlField = engine.infoJsonUrlField() ;
 
-		if( doNotGetTitle || !engine.likeYoutubeDl() ){
+	size_t batchSize = urlField.isEmpty() ? 1 : 25 ;
 
-			auto s = concurrentDownloadManagerFinishedStatus::notStarted() ;
+	while( m_titleResolvers < 2 && !m_titleRequests.empty() ){
 
-			_set_variables( m_ui,a,s,m_mainWindow ) ;
-		}else{
-			m_ctx.TabManager().disableAll() ;
+		auto s = std::min( batchSize,m_titleRequests.size() ) ;
+
+		std::vector< titleRequest > requests( m_titleRequests.begin(),m_titleRequests.begin() + s ) ;
+
+		m_titleRequests.erase( m_titleRequests.begin(),m_titleRequests.begin() + s ) ;
 
-			const auto& exe = engine.exePath().realExe() ;
-			QStringList args{ "--get-title",a } ;
+		QStringList urls ;
 
-			engines::engine::exeArgs::cmd cmd( exe,args ) ;
+		for( const auto& it : requests ){
 
-			m_ctx.logger().add( "cmd: " + engine.commandString( cmd ) ) ;
+			urls.append( it.url ) ;
+		}
+
+		m_titleResolvers++ ;
+
+		auto options = m_ui.lineEditBDUrlOptions->text() ;
 
-			_getUrlTitle( exe,args,[ a,this ]( const QString& title ){
+		m_ctx.MetadataCache().resolve( engine,urls,options,[ this,requests = std::move( requests ) ]( const metadataCache::titles& titles ){
 
-				auto state = concurrentDownloadManagerFinishedStatus::notStarted() ;
+			for( const auto& it : requests ){
 
-				if( title.isEmpty() || title == "\n" ){
+				auto m = titles.find( it.url ) ;
 
-					_set_variables( m_ui,a,state,m_mainWindow ) ;
-				}else{
-					m_ctx.logger().add( title ) ;
-					_set_variables( m_ui,a + "\n" + title,state,m_mainWindow ) ;
+				if( m != titles.end() && !m->second.isEmpty() ){
+
+					this->setTitle( it,m->second ) ;
 				}
+			}
 
-				m_ctx.TabManager().enableAll() ;
-			} ) ;
-		}
+			m_titleResolvers-- ;
+
+			this->resolveTitles() ;
+		} ) ;
 	}
 }
 
+void batchdownloader::setTitle( const titleRequest& request,const QString& title )
+{
+	auto& table = *m_ui.tableWidgetBD ;
+
+	auto item = table.item( request.row,1 ) ;
+
+	/*
+	 * The list may have been cleared and refilled while the title was
+	 * being fetched.
+	 */
+	if( request.row >= table.rowCount() || !item || item->text() != request.url ){
+
+		return ;
+	}
+
+	m_ctx.logger().add( title ) ;
+
+	auto text = request.url + "\n" + title ;
+
+	item->setText( text ) ;
+
+	auto state = concurrentDownloadManagerFinishedStatus::notStarted() ;
+
+	if( table.item( request.row,2 )->text() == state ){
+
+		table.item( request.row,0 )->setText( text ) ;
+	}
+}
+
+void batchdownloader::queueNewEntry()
+{
+	m_ccmd.add( m_ui.tableWidgetBD->rowCount() - 1,[ this ]( const engines::engine& engine,const std::vector< int >& indexes ){
+
+		this->download( engine,indexes ) ;
+	} ) ;
+}
+
 void batchdownloader::download( const engines::engine& engine )
 {
 	this->addToList( m_ui.lineEditBDUrl->text(),true ) ;
@@ -270,18 +356,39 @@ void batchdownloader::download( const engines::engine& engine )
 		return ;
 	}
 
-	m_ccmd.download( engine,[ this ](){
+	m_ccmd.download( engine,[ this ]( const engines::engine& engine,const std::vector< int >& indexes ){
+
+		this->download( engine,indexes ) ;
+	} ) ;
+}
+
+void batchdownloader::download( const engines::engine& engine,const std::vector< int >& indexes )
+{
+	if( indexes.size() == 1 ){
+
+		return this->download( engine,indexes[ 0 ] ) ;
+	}
+
+	auto group = m_ccmd.makeGroup( engine,indexes ) ;
 
-		if( m_settings.concurrentDownloading() ){
+	auto aa = batchdownloader::make_options( *m_ui.pbBDCancel,m_ctx,m_debug,[ &engine,group,this ]( bool e ){
 
-			return m_settings.maxConcurrentDownloads() ;
-		}else{
-			return 1 ;
-		}
+		m_ccmd.monitorForFinished( *group,e,[ &engine,this ]( const concurrentDownloadManagerFinishedStatus& f ){
+
+			utility::updateFinishedState( engine,m_settings,*m_ui.tableWidgetBD,f ) ;
+		} ) ;
+	} ) ;
+
+	m_ccmd.download( engine,group,std::move( aa ),[ &engine,this ]( int index ){
 
-	}(),[ this ]( const engines::engine& engine,int index ){
+		auto id = utility::concurrentID() ;
 
-		this->download( engine,index ) ;
+		return make_loggerBatchDownloader( engine.filter(),
+						   engine,
+						   m_ctx.logger(),
+						   *m_ui.tableWidgetBD->item( index,0 ),
+						   id,
+						   m_ctx.Scheduler().reporterFor( id ) ) ;
 	} ) ;
 }
 
@@ -289,16 +396,14 @@ void batchdownloader::download( const engines::engine& engine,int index )
 {
 	auto aa = batchdownloader::make_options( *m_ui.pbBDCancel,m_ctx,m_debug,[ &engine,index,this ]( bool e ){
 
-		m_ccmd.monitorForFinished( engine,index,e,[ this ]( const engines::engine& engine,int index ){
-
-			this->download( engine,index ) ;
-
-		},[ &engine,this ]( const concurrentDownloadManagerFinishedStatus& f ){
+		m_ccmd.monitorForFinished( index,e,[ &engine,this ]( const concurrentDownloadManagerFinishedStatus& f ){
 
 			utility::updateFinishedState( engine,m_settings,*m_ui.tableWidgetBD,f ) ;
 		} ) ;
 	} ) ;
 
+	auto id = utility::concurrentID() ;
+
 	m_ccmd.download( engine,
 			 index,
 			 m_ui.tableWidgetBD->item( index,1 )->text(),
@@ -307,7 +412,8 @@ void batchdownloader::download( const engines::engine& engine,int index )
 						     engine,
 						     m_ctx.logger(),
 						     *m_ui.tableWidgetBD->item( index,0 ),
-						     utility::concurrentID() ) ) ;
+						     id,
+						     m_ctx.Scheduler().reporterFor( id ) ) ) ;
 }
 
 void batchdownloader::enableAll()
@@ -333,21 +439,22 @@ void batchdownloader::disableAll()
 	m_ui.pbBDCancel->setEnabled( false ) ;
 	m_ui.tableWidgetBD->setEnabled( false ) ;
 	m_ui.pbBDDownload->setEnabled( false ) ;
-	m_ui.pbBDAdd->setEnabled( false ) ;
 	m_ui.pbBDOptions->setEnabled( false ) ;
 	m_ui.labelBDEnterOptions->setEnabled( false ) ;
-	m_ui.labelBDEnterUrl->setEnabled( false ) ;
 	m_ui.pbBDQuit->setEnabled( false ) ;
-	m_ui.lineEditBDUrl->setEnabled( false ) ;
 	m_ui.lineEditBDUrlOptions->setEnabled( false ) ;
+
+	/*
+	 * Urls can still be added to a running batch.
+	 */
+	auto e = m_ccmd.running() ;
+
+	m_ui.pbBDAdd->setEnabled( e ) ;
+	m_ui.labelBDEnterUrl->setEnabled( e ) ;
+	m_ui.lineEditBDUrl->setEnabled( e ) ;
 }
 
 void batchdownloader::EnableAll::operator()( bool e )
 {
-	if( e ){
-
-		m_tabManager.enableAll() ;
-	}else{
-		m_tabManager.disableAll() ;
-	}
+	m_tabManager.setDownloading( tabManager::tab::batch,!e ) ;
 }
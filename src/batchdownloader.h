@@ -46,11 +46,27 @@ public:
 		       const QString& opts,
 		       const QStringList&,
 		       bool doNotGetTitle ) ;
+	bool running() const
+	{
+		return m_ccmd.running() ;
+	}
 private:
 	void clearScreen() ;
+	struct titleRequest
+	{
+		titleRequest( int r,const QString& u ) : row( r ),url( u )
+		{
+		}
+		int row ;
+		QString url ;
+	} ;
 	void addToList( const QString&,bool ) ;
+	void resolveTitles() ;
+	void setTitle( const titleRequest&,const QString& ) ;
+	void queueNewEntry() ;
 	void download( const engines::engine& ) ;
 	void download( const engines::engine&,int ) ;
+	void download( const engines::engine&,const std::vector< int >& ) ;
 	const Context& m_ctx ;
 	settings& m_settings ;
 	Ui::MainWindow& m_ui ;
@@ -60,6 +76,9 @@ private:
 	bool m_debug ;
 
 	std::vector< int > m_downloadEntries ;
+	std::vector< titleRequest > m_titleRequests ;
+	int m_titleResolvers = 0 ;
+	bool m_titleResolutionPending = false ;
 
 	class Index{
 	public:
@@ -95,6 +114,10 @@ private:
 		{
 			m_index = 0 ;
 		}
+		void add( int e )
+		{
+			m_entries.emplace_back( e ) ;
+		}
 	private:
 		size_t m_index = 0 ;
 		std::vector< int >& m_entries ;
@@ -141,6 +164,10 @@ private:
 		{
 			return false ;
 		}
+		/*
+		 * Process output is never asked for, do not keep any of it.
+		 */
+		static constexpr int maxCapturedOutputSize = 0 ;
 		options& enableCancel( bool e )
 		{
 			Q_UNUSED( e )
@@ -122,13 +122,19 @@ void batchfiledownloader::download()
 
 void batchfiledownloader::disableAll()
 {
-	m_ui.lineEditFileDownloader->setEnabled( false ) ;
 	m_ui.lineEditFileOptions->setEnabled( false ) ;
-	m_ui.pbFileDownloaderDownload->setEnabled( false ) ;
-	m_ui.pbFileDownloaderFilePath->setEnabled( false ) ;
 	m_ui.pbFileDownloaderOptions->setEnabled( false ) ;
 	m_ui.pbFileDownloaderQuit->setEnabled( false ) ;
-	m_ui.labelFileDownloader->setEnabled( false ) ;
-	m_ui.labelFileDownloederPath->setEnabled( false ) ;
 	m_ui.labelFileDownloederPathOptions->setEnabled( false ) ;
+
+	/*
+	 * A batch file can still be added to a running batch.
+	 */
+	auto e = m_tabManager.batchDownloader().running() ;
+
+	m_ui.lineEditFileDownloader->setEnabled( e ) ;
+	m_ui.pbFileDownloaderDownload->setEnabled( e ) ;
+	m_ui.pbFileDownloaderFilePath->setEnabled( e ) ;
+	m_ui.labelFileDownloader->setEnabled( e ) ;
+	m_ui.labelFileDownloederPath->setEnabled( e ) ;
 }
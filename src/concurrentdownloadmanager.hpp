@@ -23,11 +23,18 @@
 #include <QTableWidget>
 #include <QStringList>
 #include <QPushButton>
+#include <QTemporaryFile>
 
 #include <memory>
+#include <algorithm>
+#include <map>
+#include <vector>
 
 #include "engines.h"
 #include "context.hpp"
+#include "scheduler.h"
+#include "workerpool.h"
+#include "metadatacache.h"
 
 #include "utility.h"
 
@@ -93,6 +100,224 @@ struct concurrentDownloadManagerFinishedStatus
 	}
 };
 
+/*
+ * Entries downloaded by a single engine process through its batch file
+ * argument. The engine's output is followed to know which entry it is on,
+ * so every entry still gets its own log and finished state.
+ */
+class concurrentDownloadGroup
+{
+public:
+	concurrentDownloadGroup( const QString& marker,std::vector< int > indexes,QStringList urls ) :
+		m_marker( marker ),
+		m_indexes( std::move( indexes ) ),
+		m_urls( std::move( urls ) ),
+		m_failed( m_indexes.size(),false )
+	{
+	}
+	const std::vector< int >& indexes() const
+	{
+		return m_indexes ;
+	}
+	bool writeBatchFile()
+	{
+		if( m_file.open() ){
+
+			m_file.write( m_urls.join( '\n' ).toUtf8() + '\n' ) ;
+			m_file.close() ;
+
+			return true ;
+		}else{
+			return false ;
+		}
+	}
+	QString batchFilePath() const
+	{
+		return m_file.fileName() ;
+	}
+	/*
+	 * Called with every line of output, returns the position in indexes()
+	 * of the entry the line belongs to. Entries are started in the order of
+	 * the batch file so a marker is matched against entries not started yet,
+	 * a marker with a url that is not one of them is taken to be a redirect
+	 * of the current one.
+	 */
+	size_t lineAdded( const QString& line )
+	{
+		auto m = line.indexOf( m_marker ) ;
+
+		if( m != -1 ){
+
+			auto url = line.mid( m + m_marker.size() ).trimmed() ;
+
+			for( auto s = m_next ; s < m_indexes.size() ; s++ ){
+
+				if( this->matches( m_urls[ static_cast< int >( s ) ],url ) ){
+
+					m_current = s ;
+					m_next = s + 1 ;
+
+					break ;
+				}
+			}
+		}
+
+		if( line.startsWith( "ERROR: " ) ){
+
+			m_failed[ m_current ] = true ;
+		}
+
+		return m_current ;
+	}
+	size_t current() const
+	{
+		return m_current ;
+	}
+	/*
+	 * The exit code only tells if every entry succeeded. When it did not,
+	 * entries the process got past succeeded unless they logged an error
+	 * and entries it never got to did not. The entry it stopped on failed
+	 * unless it is the last one and an error logged by an earlier entry
+	 * explains the exit code, the engine then went on past that error.
+	 */
+	bool succeeded( size_t position,bool processSucceeded ) const
+	{
+		if( m_failed[ position ] ){
+
+			return false ;
+
+		}else if( processSucceeded || position < m_current ){
+
+			return true ;
+
+		}else if( position == m_current && position + 1 == m_failed.size() ){
+
+			return std::find( m_failed.begin(),m_failed.end(),true ) != m_failed.end() ;
+		}else{
+			return false ;
+		}
+	}
+private:
+	/*
+	 * Engines shorten long urls in the line unless they are verbose, as in
+	 * "https://example.com/wat...ch?v=abc", with the part in the middle
+	 * replaced by three dots or an ellipsis.
+	 */
+	bool matches( const QString& url,const QString& printed ) const
+	{
+		if( printed == url ){
+
+			return true ;
+		}
+
+		for( const auto& dots : { QString( "..." ),QString( QChar( 0x2026 ) ) } ){
+
+			auto m = printed.indexOf( dots ) ;
+
+			while( m != -1 ){
+
+				auto left = printed.left( m ) ;
+				auto right = printed.mid( m + dots.size() ) ;
+
+				if( url.size() >= left.size() + right.size() && url.startsWith( left ) && url.endsWith( right ) ){
+
+					return true ;
+				}
+
+				m = printed.indexOf( dots,m + 1 ) ;
+			}
+		}
+
+		return false ;
+	}
+	QString m_marker ;
+	std::vector< int > m_indexes ;
+	QStringList m_urls ;
+	std::vector< bool > m_failed ;
+	size_t m_current = 0 ;
+	size_t m_next = 0 ;
+	QTemporaryFile m_file ;
+} ;
+
+/*
+ * Sends each line of a group's output to the logger of the entry it
+ * belongs to.
+ */
+template< typename Tlogger >
+class loggerBatchFile
+{
+public:
+	loggerBatchFile( std::shared_ptr< concurrentDownloadGroup > group,std::vector< Tlogger > loggers ) :
+		m_group( std::move( group ) ),
+		m_loggers( std::move( loggers ) )
+	{
+	}
+	void add( const QString& s )
+	{
+		m_loggers[ m_group->current() ].add( s ) ;
+	}
+	void clear()
+	{
+		for( auto& it : m_loggers ){
+
+			it.clear() ;
+		}
+	}
+	void flush()
+	{
+		for( auto& it : m_loggers ){
+
+			it.flush() ;
+		}
+	}
+	template< typename Function >
+	void add( const Function& function )
+	{
+		m_loggers[ m_group->current() ].add( function ) ;
+	}
+	/*
+	 * Every line of the update is looked at, runs of lines that belong
+	 * to the same entry go to its logger together.
+	 */
+	void add( const Logger::jobData::update& e )
+	{
+		const auto& lines = e.lines() ;
+
+		int start = 0 ;
+
+		auto current = m_group->current() ;
+
+		for( int i = 0 ; i < lines.size() ; i++ ){
+
+			if( i == 0 && e.replacesLast() ){
+
+				continue ;
+			}
+
+			auto s = m_group->lineAdded( lines[ i ] ) ;
+
+			if( s != current ){
+
+				if( i > start ){
+
+					m_loggers[ current ].add( e.mid( start,i - start ) ) ;
+				}
+
+				start = i ;
+				current = s ;
+			}
+		}
+
+		if( lines.size() > start ){
+
+			m_loggers[ current ].add( e.mid( start,lines.size() - start ) ) ;
+		}
+	}
+private:
+	std::shared_ptr< concurrentDownloadGroup > m_group ;
+	std::vector< Tlogger > m_loggers ;
+} ;
+
 template< typename Index,
 	  typename EnableAll >
 class concurrentDownloadManager
@@ -101,25 +326,34 @@ public:
 	concurrentDownloadManager( const Context& ctx,
 				   Index index,
 				   QLineEdit& lineEdit,
-				   QPushButton& cancelButton ) :
+				   QPushButton& cancelButton,
+				   scheduler::queue queue ) :
 		m_index( std::move( index ) ),
 		m_enableAll( ctx ),
 		m_ctx( ctx ),
 		m_lineEdit( lineEdit ),
 		m_table( m_index.table() ),
-		m_cancelButton( cancelButton )
+		m_cancelButton( cancelButton ),
+		m_queue( queue )
+	{
+	}
+	/*
+	 * True from the start of a download until its last entry is done or
+	 * it is cancelled, entries given to add() in between join it.
+	 */
+	bool running() const
 	{
+		return m_running ;
 	}
 	void cancelled()
 	{
 		m_cancelled = true ;
+		m_running = false ;
+
+		m_ctx.Scheduler().cancel( m_queue ) ;
 	}
-	template< typename Function,typename Finished >
-	void monitorForFinished( const engines::engine& engine,
-				 int index,
-				 bool success,
-				 Function function,
-				 Finished finished )
+	template< typename Finished >
+	void monitorForFinished( int index,bool success,Finished finished )
 	{
 		if( m_cancelled ){
 
@@ -132,53 +366,124 @@ public:
 
 			if( m_counter == m_index.count() ){
 
+				m_running = false ;
+
 				this->uiEnableAll( true ) ;
 				m_cancelButton.setEnabled( false ) ;
 
 				finished( concurrentDownloadManagerFinishedStatus{ index,false,true,success } ) ;
 			}else{
 				finished( concurrentDownloadManagerFinishedStatus{ index,false,false,success } ) ;
+			}
+		}
 
-				if( m_index.hasNext() ){
+		/*
+		 * Called last because the freed slot may start the next job
+		 * of any tab right away.
+		 */
+		auto it = m_keys.find( index ) ;
 
-					function( engine,m_index.value() ) ;
-				}
-			}
+		if( it != m_keys.end() ){
+
+			auto key = std::move( it->second ) ;
+
+			m_keys.erase( it ) ;
+
+			m_ctx.Scheduler().finished( m_queue,key ) ;
+		}
+	}
+	template< typename Finished >
+	void monitorForFinished( const concurrentDownloadGroup& group,bool success,Finished finished )
+	{
+		const auto& m = group.indexes() ;
+
+		for( size_t s = 0 ; s < m.size() ; s++ ){
+
+			this->monitorForFinished( m[ s ],group.succeeded( s,success ),finished ) ;
 		}
 	}
+	/*
+	 * ConcurrentDownload is called with the engine and the entries one
+	 * engine process is to download.
+	 */
 	template< typename ConcurrentDownload >
-	void download( const engines::engine& engine,
-		       int maxNumberOfConcurrency,
-		       ConcurrentDownload concurrentDownload )
+	void download( const engines::engine& engine,ConcurrentDownload concurrentDownload )
 	{
 		if( m_table.rowCount() ){
 
 			m_counter = 0 ;
 			m_cancelled = false ;
+			m_running = true ;
+			m_engine = &engine ;
 			m_index.reset() ;
 
 			this->uiEnableAll( false ) ;
 			m_cancelButton.setEnabled( true ) ;
-			m_table.setEnabled( true ) ;			
+			m_table.setEnabled( true ) ;
 
-			auto max = [ & ](){
+			/*
+			 * The scheduler decides how many of these run at once,
+			 * the limit is shared with downloads from other tabs.
+			 */
+			auto groupSize = this->groupSize( engine ) ;
 
-				auto count = m_index.count() ;
+			if( groupSize == 1 ){
 
-				if( maxNumberOfConcurrency < count ){
+				for( int s = 0 ; s < m_index.count() ; s++ ){
 
-					return maxNumberOfConcurrency ;
-				}else{
-					return count ;
+					this->submit( engine,{ m_index.value( s ) },concurrentDownload ) ;
 				}
-			}() ;
+			}else{
+				/*
+				 * Entries of a group share one slot, grouping them by
+				 * host keeps per host limits meaningful.
+				 */
+				std::map< QString,std::vector< int > > groups ;
+
+				for( int s = 0 ; s < m_index.count() ; s++ ){
+
+					auto index = m_index.value( s ) ;
+
+					auto& group = groups[ this->key( engine,index ).host ] ;
+
+					group.emplace_back( index ) ;
 
-			for( int s = 0 ; s < max ; s++ ){
+					if( group.size() == groupSize ){
 
-				concurrentDownload( engine,m_index.value( s ) ) ;
+						this->submit( engine,std::move( group ),concurrentDownload ) ;
+
+						group.clear() ;
+					}
+				}
+
+				for( auto& it : groups ){
+
+					if( !it.second.empty() ){
+
+						this->submit( engine,std::move( it.second ),concurrentDownload ) ;
+					}
+				}
 			}
 		}
 	}
+	/*
+	 * Queues one more entry to the running download, the entry counts
+	 * towards it being all finished.
+	 */
+	template< typename ConcurrentDownload >
+	bool add( int index,ConcurrentDownload concurrentDownload )
+	{
+		if( m_running ){
+
+			m_index.add( index ) ;
+
+			this->submit( *m_engine,{ index },std::move( concurrentDownload ) ) ;
+
+			return true ;
+		}else{
+			return false ;
+		}
+	}
 	template< typename Options,typename Logger >
 	void download( const engines::engine& engine,
 		       int index,
@@ -201,19 +506,198 @@ public:
 			u = utility::split( u,'\n',true ).at( 0 ) ;
 		}
 
-		utility::run( engine,
-			      utility::updateOptions( engine,args,{ u } ),
-			      args.quality,
-			      std::move( opts ),
-			      std::move( logger ),
-			      utility::make_term_conn( &m_cancelButton,&QPushButton::clicked ) ) ;
+		/*
+		 * Info json kept from resolving the title saves extracting the
+		 * url a second time.
+		 */
+		auto infoJson = this->infoJson( engine,u ) ;
+
+		if( infoJson.isEmpty() ){
+
+			this->run( engine,utility::updateOptions( engine,args,{ u } ),args.quality,std::move( opts ),std::move( logger ) ) ;
+		}else{
+			auto m = utility::updateOptions( engine,args,{} ) ;
+
+			m.append( engine.loadInfoJsonArgument() ) ;
+			m.append( infoJson ) ;
+
+			this->run( engine,m,args.quality,std::move( opts ),std::move( logger ) ) ;
+		}
+	}
+	/*
+	 * MakeLogger is called with each entry of the group and returns the
+	 * logger for that entry's row.
+	 */
+	template< typename Options,typename MakeLogger >
+	void download( const engines::engine& engine,
+		       std::shared_ptr< concurrentDownloadGroup > group,
+		       Options opts,
+		       MakeLogger makeLogger )
+	{
+		using logger_t = utility::types::result_of< MakeLogger,int > ;
+
+		std::vector< logger_t > loggers ;
+
+		for( const auto& it : group->indexes() ){
+
+			m_index++ ;
+
+			loggers.emplace_back( makeLogger( it ) ) ;
+		}
+
+		if( !group->writeBatchFile() ){
+
+			m_ctx.logger().add( QObject::tr( "Failed to open file for writing" ) + ": " + group->batchFilePath() ) ;
+
+			opts.done( false ) ;
+
+			return ;
+		}
+
+		utility::args args( m_lineEdit.text() ) ;
+
+		auto m = utility::updateOptions( engine,args,{} ) ;
+
+		m.append( engine.batchFileArgument() ) ;
+		m.append( group->batchFilePath() ) ;
+
+		this->run( engine,m,args.quality,std::move( opts ),loggerBatchFile< logger_t >( group,std::move( loggers ) ) ) ;
+	}
+	std::shared_ptr< concurrentDownloadGroup > makeGroup( const engines::engine& engine,const std::vector< int >& indexes )
+	{
+		QStringList urls ;
+
+		for( const auto& it : indexes ){
+
+			urls.append( this->url( it ) ) ;
+		}
+
+		return std::make_shared< concurrentDownloadGroup >( engine.batchFileUrlMarker(),indexes,std::move( urls ) ) ;
 	}
 private:
+	template< typename Options,typename Logger >
+	void run( const engines::engine& engine,
+		  const QStringList& args,
+		  const QString& quality,
+		  Options opts,
+		  Logger logger )
+	{
+		auto& workers = m_ctx.Workers() ;
+
+		if( workers.usable( engine ) ){
+
+			workers.run( engine,
+				     args,
+				     quality,
+				     std::move( opts ),
+				     std::move( logger ),
+				     utility::make_term_conn( &m_cancelButton,&QPushButton::clicked ) ) ;
+		}else{
+			utility::run( engine,
+				      args,
+				      quality,
+				      std::move( opts ),
+				      std::move( logger ),
+				      utility::make_term_conn( &m_cancelButton,&QPushButton::clicked ) ) ;
+		}
+	}
+	/*
+	 * Packing urls into one process needs an engine that takes a batch
+	 * file and tells in its output when it moves to the next url.
+	 */
+	size_t groupSize( const engines::engine& engine )
+	{
+		auto m = m_ctx.Settings().urlsPerProcess() ;
+
+		if( m > 1 && !engine.batchFileArgument().isEmpty() && !engine.batchFileUrlMarker().isEmpty() ){
+
+			return static_cast< size_t >( m ) ;
+		}else{
+			return 1 ;
+		}
+	}
+	template< typename ConcurrentDownload >
+	void submit( const engines::engine& engine,std::vector< int > indexes,ConcurrentDownload concurrentDownload )
+	{
+		/*
+		 * A group takes one slot, the slot is given back when its
+		 * first entry finishes because the others finish with it.
+		 */
+		auto key = this->key( engine,indexes[ 0 ] ) ;
+
+		auto prefetch = this->prefetch( engine,indexes ) ;
+
+		m_ctx.Scheduler().submit( m_queue,key,[ this,&engine,indexes = std::move( indexes ),key,concurrentDownload ](){
+
+			m_keys[ indexes[ 0 ] ] = key ;
+
+			concurrentDownload( engine,indexes ) ;
+
+		},std::move( prefetch ) ) ;
+	}
+	/*
+	 * Resolves the info json of a queued entry while the slots are busy
+	 * so its download starts from it, groups pass urls and are not
+	 * prefetched.
+	 */
+	scheduler::prefetcher prefetch( const engines::engine& engine,const std::vector< int >& indexes )
+	{
+		if( indexes.size() != 1 || engine.loadInfoJsonArgument().isEmpty() || !engine.likeYoutubeDl() ){
+
+			return nullptr ;
+		}
+
+		auto url = this->url( indexes[ 0 ] ) ;
+
+		if( url.isEmpty() ){
+
+			return nullptr ;
+		}
+
+		return [ this,&engine,url ]( std::function< void() > done ){
+
+			if( this->infoJson( engine,url ).isEmpty() ){
+
+				m_ctx.MetadataCache().resolve( engine,{ url },m_lineEdit.text(),[ done ]( const metadataCache::titles& ){
+
+					done() ;
+				} ) ;
+			}else{
+				done() ;
+			}
+		} ;
+	}
+	QString infoJson( const engines::engine& engine,const QString& url )
+	{
+		if( engine.loadInfoJsonArgument().isEmpty() || url.isEmpty() ){
+
+			return QString() ;
+		}else{
+			return m_ctx.MetadataCache().infoJson( engine,url,m_lineEdit.text() ) ;
+		}
+	}
+	QString url( int index )
+	{
+		auto item = m_table.item( index,1 ) ;
+
+		if( item ){
+
+			return utility::split( item->text(),'\n',true ).value( 0 ) ;
+		}else{
+			return QString() ;
+		}
+	}
+	scheduler::key key( const engines::engine& engine,int index )
+	{
+		return { engine,this->url( index ) } ;
+	}
 	void uiEnableAll( bool e )
 	{
 		m_enableAll( e ) ;
 	}
 	int m_counter ;
+	bool m_running = false ;
+	const engines::engine * m_engine = nullptr ;
 	Index m_index ;
 	EnableAll m_enableAll ;
 	bool m_cancelled ;
@@ -221,6 +705,8 @@ private:
 	QLineEdit& m_lineEdit ;
 	QTableWidget& m_table ;
 	QPushButton& m_cancelButton ;
+	scheduler::queue m_queue ;
+	std::map< int,scheduler::key > m_keys ;
 } ;
 
 #endif
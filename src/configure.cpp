@@ -25,6 +25,19 @@
 
 #include <QFileDialog>
 #include <QFile>
+#include <QSignalBlocker>
+
+static void _setNumber( QLineEdit * e,qulonglong minimum,std::function< void( qulonglong ) > function )
+{
+	bool ok ;
+
+	auto m = e->text().toULongLong( &ok ) ;
+
+	if( ok ){
+
+		function( m < minimum ? minimum : m ) ;
+	}
+}
 
 configure::configure( const Context& ctx ) :
 	m_ctx( ctx ),
@@ -47,6 +60,32 @@ configure::configure( const Context& ctx ) :
 	connect( m_ui.cbConfigureBatchDownloadConcurrently,&QCheckBox::stateChanged,[ this ]( int ){
 
 		this->enableConcurrentTextField() ;
+		this->saveConcurrencyOptions() ;
+	} ) ;
+
+	connect( m_ui.lineEditConfigureMaximuConcurrentDownloads,&QLineEdit::editingFinished,[ this ](){
+
+		this->saveConcurrencyOptions() ;
+	} ) ;
+
+	connect( m_ui.lineEditConfigureMaxConcurrentDownloadsPerHost,&QLineEdit::editingFinished,[ this ](){
+
+		this->saveConcurrencyOptions() ;
+	} ) ;
+
+	connect( m_ui.lineEditConfigureUrlsPerProcess,&QLineEdit::editingFinished,[ this ](){
+
+		this->saveConcurrencyOptions() ;
+	} ) ;
+
+	connect( m_ui.lineEditConfigurePrefetchCount,&QLineEdit::editingFinished,[ this ](){
+
+		this->saveConcurrencyOptions() ;
+	} ) ;
+
+	connect( m_ui.cbConfigureAutoConcurrentDownloads,&QCheckBox::stateChanged,[ this ]( int ){
+
+		this->saveConcurrencyOptions() ;
 	} ) ;
 
 	connect( m_ui.cbUseSystemVersionIfAvailable,&QCheckBox::stateChanged,[ this ]( int ){
@@ -155,18 +194,52 @@ configure::configure( const Context& ctx ) :
 
 	m_ui.cbConfigureShowVersionInfo->setChecked( m_settings.showVersionInfoWhenStarting() ) ;
 
+	/*
+	 * Changing a check box saves all the concurrency options, the
+	 * blockers keep loading them from saving half loaded values.
+	 */
+	QSignalBlocker batchBlocker( m_ui.cbConfigureBatchDownloadConcurrently ) ;
+	QSignalBlocker autoBlocker( m_ui.cbConfigureAutoConcurrentDownloads ) ;
+
+	m_ui.lineEditConfigureMaximuConcurrentDownloads->setText( QString::number( m_settings.maxConcurrentDownloads() ) ) ;
+
+	m_ui.lineEditConfigureMaxConcurrentDownloadsPerHost->setText( QString::number( m_settings.maxConcurrentDownloadsPerHost() ) ) ;
+
+	m_ui.lineEditConfigureUrlsPerProcess->setText( QString::number( m_settings.urlsPerProcess() ) ) ;
+
+	m_ui.lineEditConfigurePrefetchCount->setText( QString::number( m_settings.prefetchCount() ) ) ;
+
 	m_ui.cbConfigureBatchDownloadConcurrently->setChecked( m_settings.concurrentDownloading() ) ;
 
+	m_ui.cbConfigureAutoConcurrentDownloads->setChecked( m_settings.autoConcurrentDownloads() ) ;
+
+	m_ui.lineEditConfigureMaxLoggerLines->setText( QString::number( m_settings.maxLoggerLines() ) ) ;
+
+	m_ui.lineEditConfigureMaxLoggerSize->setText( QString::number( m_settings.maxLoggerSize() ) ) ;
+
+	m_ui.cbConfigureLogHistoryOnDisk->setChecked( m_settings.logHistoryOnDisk() ) ;
+
 	m_ui.cbUseSystemVersionIfAvailable->setChecked( m_settings.useSystemProvidedVersionIfAvailable() ) ;
 
 	m_ui.cbUseSystemVersionIfAvailable->setEnabled( utility::platformIsLinux() ) ;
-
-	m_ui.lineEditConfigureMaximuConcurrentDownloads->setText( QString::number( m_settings.maxConcurrentDownloads() ) ) ;
 }
 
 void configure::init_done()
 {
 	this->enableConcurrentTextField() ;
+#ifndef QT_NO_DEBUG
+	/*
+	 * Saving what was just loaded has to give back the same settings,
+	 * the automatic limit used to be turned off on every start.
+	 */
+	auto concurrent = m_settings.concurrentDownloading() ;
+	auto autoConcurrent = m_settings.autoConcurrentDownloads() ;
+
+	this->saveConcurrencyOptions() ;
+
+	Q_ASSERT( m_settings.concurrentDownloading() == concurrent ) ;
+	Q_ASSERT( m_settings.autoConcurrentDownloads() == autoConcurrent ) ;
+#endif
 }
 
 void configure::retranslateUi()
@@ -198,6 +271,7 @@ void configure::enableConcurrentTextField()
 
 	m_ui.lineEditConfigureMaximuConcurrentDownloads->setEnabled( s ) ;
 	m_ui.labelMaximumConcurrentDownloads->setEnabled( s ) ;
+	m_ui.cbConfigureAutoConcurrentDownloads->setEnabled( s ) ;
 }
 
 void configure::saveOptions()
@@ -206,8 +280,28 @@ void configure::saveOptions()
 	m_settings.setPresetOptions( m_ui.textEditConfigurePresetOptions->toPlainText() ) ;
 	m_settings.setDownloadFolder( m_ui.lineEditConfigureDownloadPath->text() ) ;
 	m_settings.setShowVersionInfoWhenStarting( m_ui.cbConfigureShowVersionInfo->isChecked() ) ;
-	m_settings.setConcurrentDownloading( m_ui.cbConfigureBatchDownloadConcurrently->isChecked() ) ;
 	m_settings.setUseSystemProvidedVersionIfAvailable( m_ui.cbUseSystemVersionIfAvailable->isChecked() ) ;
+	m_settings.setLogHistoryOnDisk( m_ui.cbConfigureLogHistoryOnDisk->isChecked() ) ;
+
+	/*
+	 * The logger reads these when it is created, they apply from the next start.
+	 */
+	_setNumber( m_ui.lineEditConfigureMaxLoggerLines,1,[ this ]( qulonglong m ){
+
+		m_settings.setMaxLoggerLines( m ) ;
+	} ) ;
+
+	_setNumber( m_ui.lineEditConfigureMaxLoggerSize,1024,[ this ]( qulonglong m ){
+
+		m_settings.setMaxLoggerSize( m ) ;
+	} ) ;
+
+	this->saveConcurrencyOptions() ;
+}
+
+void configure::saveConcurrencyOptions()
+{
+	m_settings.setConcurrentDownloading( m_ui.cbConfigureBatchDownloadConcurrently->isChecked() ) ;
 
 	auto s = m_ui.lineEditConfigureMaximuConcurrentDownloads->text() ;
 
@@ -229,6 +323,28 @@ void configure::saveOptions()
 			}
 		}
 	}
+
+	m_settings.setAutoConcurrentDownloads( m_ui.cbConfigureAutoConcurrentDownloads->isChecked() ) ;
+
+	_setNumber( m_ui.lineEditConfigureMaxConcurrentDownloadsPerHost,0,[ this ]( qulonglong m ){
+
+		m_settings.setMaxConcurrentDownloadsPerHost( static_cast< int >( m ) ) ;
+	} ) ;
+
+	_setNumber( m_ui.lineEditConfigureUrlsPerProcess,1,[ this ]( qulonglong m ){
+
+		m_settings.setUrlsPerProcess( static_cast< int >( m ) ) ;
+	} ) ;
+
+	_setNumber( m_ui.lineEditConfigurePrefetchCount,0,[ this ]( qulonglong m ){
+
+		m_settings.setPrefetchCount( static_cast< int >( m ) ) ;
+	} ) ;
+
+	/*
+	 * Running downloads pick the new limits up right away.
+	 */
+	m_ctx.Scheduler().limitsChanged() ;
 }
 
 void configure::manageDownloadButton()
@@ -293,6 +409,17 @@ void configure::enableAll()
 	m_ui.cbConfigureBatchDownloadConcurrently->setEnabled( true ) ;
 	m_ui.labelMaximumConcurrentDownloads->setEnabled( true ) ;
 	m_ui.cbUseSystemVersionIfAvailable->setEnabled( true ) ;
+	m_ui.lineEditConfigureMaxConcurrentDownloadsPerHost->setEnabled( true ) ;
+	m_ui.labelConfigureMaxConcurrentDownloadsPerHost->setEnabled( true ) ;
+	m_ui.lineEditConfigureUrlsPerProcess->setEnabled( true ) ;
+	m_ui.labelConfigureUrlsPerProcess->setEnabled( true ) ;
+	m_ui.lineEditConfigurePrefetchCount->setEnabled( true ) ;
+	m_ui.labelConfigurePrefetchCount->setEnabled( true ) ;
+	m_ui.lineEditConfigureMaxLoggerLines->setEnabled( true ) ;
+	m_ui.labelConfigureMaxLoggerLines->setEnabled( true ) ;
+	m_ui.lineEditConfigureMaxLoggerSize->setEnabled( true ) ;
+	m_ui.labelConfigureMaxLoggerSize->setEnabled( true ) ;
+	m_ui.cbConfigureLogHistoryOnDisk->setEnabled( true ) ;
 
 	this->enableConcurrentTextField() ;
 
@@ -306,8 +433,6 @@ void configure::disableAll()
 {
 	m_setEnabled = false ;
 	m_ui.cbUseSystemVersionIfAvailable->setEnabled( false ) ;
-	m_ui.lineEditConfigureMaximuConcurrentDownloads->setEnabled( false ) ;
-	m_ui.labelMaximumConcurrentDownloads->setEnabled( false ) ;
 	m_ui.pbConfigureAddAPlugin->setEnabled( false ) ;
 	m_ui.pbConfigureRemoveAPlugin->setEnabled( false ) ;
 	m_ui.cbConfigureShowVersionInfo->setEnabled( false ) ;
@@ -323,5 +448,9 @@ void configure::disableAll()
 	m_ui.pbConfigureSetPresetDefaults->setEnabled( false ) ;
 	m_ui.labelConfigureScaleFactor->setEnabled( false ) ;
 	m_ui.labelConfigureDownloadPath->setEnabled( false ) ;
-	m_ui.cbConfigureBatchDownloadConcurrently->setEnabled( false ) ;
+	m_ui.lineEditConfigureMaxLoggerLines->setEnabled( false ) ;
+	m_ui.labelConfigureMaxLoggerLines->setEnabled( false ) ;
+	m_ui.lineEditConfigureMaxLoggerSize->setEnabled( false ) ;
+	m_ui.labelConfigureMaxLoggerSize->setEnabled( false ) ;
+	m_ui.cbConfigureLogHistoryOnDisk->setEnabled( false ) ;
 }
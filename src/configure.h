@@ -42,6 +42,7 @@ public:
 private:
 	void enableConcurrentTextField() ;
 	void saveOptions() ;
+	void saveConcurrencyOptions() ;
 	void manageDownloadButton() ;
 	bool m_setEnabled ;
 	const Context& m_ctx ;
@@ -49,6 +49,9 @@ class settings ;
 class MainWindow ;
 class MainWindowUi ;
 class Logger ;
+class scheduler ;
+class workerPool ;
+class metadataCache ;
 
 class QWidget ;
 
@@ -66,7 +69,10 @@ public:
 		 MainWindow& mw,
 		 Logger& l,
 		 engines& e,
-		 tabManager& tm ) :
+		 tabManager& tm,
+		 scheduler& sc,
+		 workerPool& wp,
+		 metadataCache& mc ) :
 		m_settings( s ),
 		m_translator( t ),
 		m_mainUi( m ),
@@ -75,6 +81,9 @@ public:
 		m_logger( l ),
 		m_engines( e ),
 		m_tabManager( tm ),
+		m_scheduler( sc ),
+		m_workerPool( wp ),
+		m_metadataCache( mc ),
 		m_debug( QCoreApplication::arguments().contains( "--debug" ) )
 	{
 	}
@@ -110,6 +119,18 @@ public:
 	{
 		return m_logger ;
 	}
+	scheduler& Scheduler() const
+	{
+		return m_scheduler ;
+	}
+	workerPool& Workers() const
+	{
+		return m_workerPool ;
+	}
+	metadataCache& MetadataCache() const
+	{
+		return m_metadataCache ;
+	}
 	bool debug() const
 	{
 		return m_debug ;
@@ -123,6 +144,9 @@ private:
 	Logger& m_logger ;
 	engines& m_engines ;
 	tabManager& m_tabManager ;
+	scheduler& m_scheduler ;
+	workerPool& m_workerPool ;
+	metadataCache& m_metadataCache ;
 	bool m_debug ;
 };
 
@@ -30,6 +30,10 @@
 #include <QJsonDocument>
 
 #include <QDir>
+#include <QUrl>
+
+#include <algorithm>
+#include <cstring>
 
 static QProcessEnvironment _getEnvPaths( const engines::enginePaths& paths,settings& settings )
 {
@@ -360,6 +364,8 @@ engines::engine::engine( const engines& engines,
 	m_position( position ),
 	m_valid( true ),
 	m_mainEngine( false ),
+	m_useWorkerProcesses( false ),
+	m_maxConcurrentDownloads( 0 ),
 	m_name( name ),
 	m_commandName( name ),
 	m_commandNameWindows( m_commandName + ".exe" ),
@@ -390,6 +396,8 @@ engines::engine::engine( Logger& logger,
 	m_canDownloadPlaylist( m_jsonObject.value( "CanDownloadPlaylist" ).toBool() ),
 	m_likeYoutubeDl( m_jsonObject.value( "LikeYoutubeDl" ).toBool( false ) ),
 	m_mainEngine( true ),
+	m_useWorkerProcesses( m_jsonObject.value( "UseWorkerProcesses" ).toBool( false ) ),
+	m_maxConcurrentDownloads( m_jsonObject.value( "MaxConcurrentDownloads" ).toInt( 0 ) ),
 	m_name( m_jsonObject.value( "Name" ).toString() ),
 	m_commandName( m_jsonObject.value( "CommandName" ).toString() ),
 	m_commandNameWindows( m_jsonObject.value( "CommandNameWindows" ).toString() ),
@@ -402,6 +410,10 @@ engines::engine::engine( Logger& logger,
 	m_playListUrlPrefix( m_jsonObject.value( "PlayListUrlPrefix" ).toString() ),
 	m_playlistItemsArgument( m_jsonObject.value( "PlaylistItemsArgument" ).toString() ),
 	m_batchFileArgument( m_jsonObject.value( "BatchFileArgument" ).toString() ),
+	m_batchFileUrlMarker( m_jsonObject.value( "BatchFileUrlMarker" ).toString() ),
+	m_infoJsonUrlField( m_jsonObject.value( "InfoJsonUrlField" ).toString() ),
+	m_loadInfoJsonArgument( m_jsonObject.value( "LoadInfoJsonArgument" ).toString() ),
+	m_concurrencyKey( m_jsonObject.value( "ConcurrencyKey" ).toString() ),
 	m_playListIdArguments( _toStringList( m_jsonObject.value( "PlayListIdArguments" ) ) ),
 	m_splitLinesBy( _toStringList( m_jsonObject.value( "SplitLinesBy" ) ) ),
 	m_removeText( _toStringList( m_jsonObject.value( "RemoveText" ) ) ),
@@ -554,6 +566,16 @@ const QString& engines::engine::commandName() const
 	}
 }
 
+QString engines::engine::concurrencyKey( const QString& url ) const
+{
+	if( !m_concurrencyKey.isEmpty() ){
+
+		return m_concurrencyKey ;
+	}else{
+		return QUrl( url.trimmed() ).host().toLower() ;
+	}
+}
+
 QString engines::engine::versionString( const QString& data ) const
 {
 	auto a = utility::split( data,'\n',true ) ;
@@ -596,6 +618,21 @@ engines::engine::functions::~functions()
 {
 }
 
+engines::engine::functions::event engines::engine::functions::parseOutput( const engines::engine&,const QString& line )
+{
+	if( line.startsWith( "ERROR: " ) ){
+
+		return { engines::engine::functions::event::type::error,line } ;
+	}else{
+		return {} ;
+	}
+}
+
+bool engines::engine::functions::stripParserText( QString& )
+{
+	return false ;
+}
+
 std::unique_ptr< engines::engine::functions::filter > engines::engine::functions::Filter()
 {
 	return std::make_unique< engines::engine::functions::filter >() ;
@@ -617,166 +654,550 @@ QString engines::engine::functions::commandString( const engines::engine::exeArg
 	return m ;
 }
 
-void engines::engine::functions::sendCredentials( const engines::engine&,
-						  const QString&,
-						  QProcess& )
+QByteArray engines::engine::functions::credentials( const engines::engine&,const QString& )
 {
+	return QByteArray() ;
 }
 
-static bool _meet_condition( const QString& line,const QJsonObject& obj )
+engines::engine::textMatcher::textMatcher( const QStringList& texts )
 {
-	if( obj.contains( "startsWith" ) ){
+	std::vector< node > nodes( 1 ) ;
 
-		return line.startsWith( obj.value( "startsWith" ).toString() ) ;
-	}
+	for( const auto& it : texts ){
+
+		auto m = it.toUtf8() ;
+
+		if( m.isEmpty() ){
+
+			/*
+			 * QByteArray::contains() finds an empty string in every line.
+			 */
+			m_hasEmptyText = true ;
+
+			continue ;
+		}
+
+		int s = 0 ;
+
+		for( auto c : m ){
+
+			auto& next = nodes[ static_cast< size_t >( s ) ].next[ static_cast< unsigned char >( c ) ] ;
+
+			if( next == -1 ){
+
+				auto depth = nodes[ static_cast< size_t >( s ) ].depth + 1 ;
+
+				next = static_cast< int >( nodes.size() ) ;
+
+				nodes.emplace_back() ;
+
+				nodes.back().depth = depth ;
+			}
+
+			s = nodes[ static_cast< size_t >( s ) ].next[ static_cast< unsigned char >( c ) ] ;
+		}
 
-	if( obj.contains( "endsWith" ) ){
+		nodes[ static_cast< size_t >( s ) ].match = m.size() ;
 
-		return line.endsWith( obj.value( "endsWith" ).toString() ) ;
+		m_maxLength = std::max( m_maxLength,m.size() ) ;
 	}
 
-	if( obj.contains( "contains" ) ){
+	/*
+	 * Breadth first fill in of failure links, missing transitions are
+	 * replaced with the ones of the failure node so matching never
+	 * has to backtrack.
+	 */
+	std::vector< int > queue ;
 
-		return line.contains( obj.value( "contains" ).toString() ) ;
+	auto& root = nodes[ 0 ] ;
+
+	for( auto& it : root.next ){
+
+		if( it == -1 ){
+
+			it = 0 ;
+		}else{
+			queue.emplace_back( it ) ;
+		}
 	}
 
-	if( obj.contains( "containsAny" ) ){
+	for( size_t i = 0 ; i < queue.size() ; i++ ){
 
-		const auto arr = obj.value( "containsAny" ).toArray() ;
+		auto s = static_cast< size_t >( queue[ i ] ) ;
 
-		for( const auto& it : arr ){
+		for( size_t c = 0 ; c < 256 ; c++ ){
 
-			if( line.contains( it.toString() ) ) {
+			auto next = nodes[ s ].next[ c ] ;
+			auto fail = nodes[ static_cast< size_t >( nodes[ s ].fail ) ].next[ c ] ;
 
-				return true ;
+			if( next == -1 ){
+
+				nodes[ s ].next[ c ] = fail ;
+			}else{
+				auto& e = nodes[ static_cast< size_t >( next ) ] ;
+
+				e.fail = fail ;
+
+				if( e.match == 0 ){
+
+					e.match = nodes[ static_cast< size_t >( fail ) ].match ;
+				}
+
+				queue.emplace_back( next ) ;
 			}
 		}
+	}
+
+	m_nodes = std::make_shared< const std::vector< node > >( std::move( nodes ) ) ;
+}
+
+bool engines::engine::textMatcher::foundIn( const char * data,int size ) const
+{
+	if( m_hasEmptyText ){
+
+		return true ;
+	}
+
+	if( !m_nodes || m_nodes->size() < 2 ){
 
 		return false ;
 	}
 
-	if( obj.contains( "containsAll" ) ){
+	const auto& nodes = *m_nodes ;
+
+	int s = 0 ;
+
+	for( int i = 0 ; i < size ; i++ ){
+
+		s = nodes[ static_cast< size_t >( s ) ].next[ static_cast< unsigned char >( data[ i ] ) ] ;
+
+		if( nodes[ static_cast< size_t >( s ) ].match ){
+
+			return true ;
+		}
+	}
+
+	return false ;
+}
+
+void engines::engine::textMatcher::removeFrom( QByteArray& e ) const
+{
+	if( !m_nodes || m_nodes->size() < 2 ){
+
+		return ;
+	}
+
+	const auto& nodes = *m_nodes ;
 
-		const auto arr = obj.value( "containsAll" ).toArray() ;
+	QByteArray m ;
 
-		for( const auto& it : arr ){
+	int s = 0 ;
+	int start = 0 ;
 
-			if( !line.contains( it.toString() ) ) {
+	for( int i = 0 ; i < e.size() ; i++ ){
+
+		s = nodes[ static_cast< size_t >( s ) ].next[ static_cast< unsigned char >( e.at( i ) ) ] ;
+
+		auto match = nodes[ static_cast< size_t >( s ) ].match ;
+
+		if( match ){
+
+			if( m.isEmpty() ){
+
+				m.reserve( e.size() ) ;
+			}
+
+			/*
+			 * The first match to end may be shorter than one that
+			 * starts at the same place or earlier and ends later, the
+			 * places one could start at are looked at in order.
+			 */
+			auto position = std::max( start,i + 1 - m_maxLength ) ;
+
+			auto length = this->longestAt( e.constData(),e.size(),position ) ;
+
+			while( length == 0 ){
+
+				length = this->longestAt( e.constData(),e.size(),++position ) ;
+			}
+
+			m.append( e.constData() + start,position - start ) ;
+
+			start = position + length ;
+
+			/*
+			 * Matches do not overlap, start over after every one.
+			 */
+			i = start - 1 ;
+
+			s = 0 ;
+		}
+	}
+
+	if( start > 0 ){
+
+		m.append( e.constData() + start,e.size() - start ) ;
+
+		e = std::move( m ) ;
+	}
+}
+
+/*
+ * Follows only the edges of the trie, a missing one was filled in with a
+ * failure transition that leads to a node that is not one deeper.
+ */
+int engines::engine::textMatcher::longestAt( const char * data,int size,int position ) const
+{
+	const auto& nodes = *m_nodes ;
+
+	int s = 0 ;
+	int length = 0 ;
+
+	for( int i = position ; i < size ; i++ ){
+
+		const auto& current = nodes[ static_cast< size_t >( s ) ] ;
+
+		auto next = current.next[ static_cast< unsigned char >( data[ i ] ) ] ;
+
+		const auto& e = nodes[ static_cast< size_t >( next ) ] ;
+
+		if( e.depth != current.depth + 1 ){
+
+			break ;
+		}
+
+		s = next ;
+
+		if( e.match == e.depth ){
+
+			length = e.depth ;
+		}
+	}
+
+	return length ;
+}
+
+engines::engine::condition::predicate::predicate( const QJsonValue& value ) :
+	m_type( type::none )
+{
+	if( !value.isObject() ){
+
+		return ;
+	}
+
+	auto obj = value.toObject() ;
+
+	if( obj.contains( "startsWith" ) ){
+
+		m_type = type::startsWith ;
+		m_text = obj.value( "startsWith" ).toString() ;
+
+	}else if( obj.contains( "endsWith" ) ){
+
+		m_type = type::endsWith ;
+		m_text = obj.value( "endsWith" ).toString() ;
+
+	}else if( obj.contains( "contains" ) ){
+
+		m_type = type::contains ;
+		m_text = obj.value( "contains" ).toString() ;
+
+	}else if( obj.contains( "containsAny" ) ){
+
+		m_type = type::containsAny ;
+		m_texts = _toStringList( obj.value( "containsAny" ) ) ;
+
+	}else if( obj.contains( "containsAll" ) ){
+
+		m_type = type::containsAll ;
+		m_texts = _toStringList( obj.value( "containsAll" ) ) ;
+	}
+
+	m_utf8Text = m_text.toUtf8() ;
+
+	for( const auto& it : m_texts ){
+
+		m_utf8Texts.append( it.toUtf8() ) ;
+	}
+}
+
+static bool _starts_with( const char * line,int size,const QByteArray& e )
+{
+	return size >= e.size() && std::equal( e.begin(),e.end(),line ) ;
+}
+
+static bool _ends_with( const char * line,int size,const QByteArray& e )
+{
+	return size >= e.size() && std::equal( e.begin(),e.end(),line + size - e.size() ) ;
+}
+
+static bool _contains( const char * line,int size,const QByteArray& e )
+{
+	return std::search( line,line + size,e.begin(),e.end() ) != line + size || e.isEmpty() ;
+}
+
+bool engines::engine::condition::predicate::match( const char * line,int size ) const
+{
+	switch( m_type ){
+
+	case type::startsWith :
+
+		return _starts_with( line,size,m_utf8Text ) ;
+
+	case type::endsWith :
+
+		return _ends_with( line,size,m_utf8Text ) ;
+
+	case type::contains :
+
+		return _contains( line,size,m_utf8Text ) ;
+
+	case type::containsAny :
+
+		for( const auto& it : m_utf8Texts ){
+
+			if( _contains( line,size,it ) ){
+
+				return true ;
+			}
+		}
+
+		return false ;
+
+	case type::containsAll :
+
+		for( const auto& it : m_utf8Texts ){
+
+			if( !_contains( line,size,it ) ){
 
 				return false ;
 			}
 		}
 
 		return true ;
+
+	case type::none :
+
+		return false ;
 	}
 
 	return false ;
 }
 
-static bool _meet_condition( const engines::engine& engine,const QString& line )
+bool engines::engine::condition::predicate::match( const QString& line ) const
 {
-	const auto& obj = engine.controlStructure() ;
+	switch( m_type ){
 
-	auto connector = obj.value( "Connector" ).toString() ;
+	case type::startsWith :
 
-	if( connector.isEmpty() ){
+		return line.startsWith( m_text ) ;
 
-		auto oo = obj.value( "lhs" ) ;
+	case type::endsWith :
 
-		if( oo.isObject() ){
+		return line.endsWith( m_text ) ;
 
-			return _meet_condition( line,oo.toObject() ) ;
-		}else{
-			return false ;
-		}
-	}else{
-		auto obj1 = obj.value( "lhs" ) ;
-		auto obj2 = obj.value( "rhs" ) ;
+	case type::contains :
 
-		if( obj1.isObject() && obj2.isObject() ){
+		return line.contains( m_text ) ;
 
-			auto a = _meet_condition( line,obj1.toObject() ) ;
-			auto b = _meet_condition( line,obj2.toObject() ) ;
+	case type::containsAny :
 
-			if( connector == "&&" ){
+		for( const auto& it : m_texts ){
 
-				return a && b ;
+			if( line.contains( it ) ){
 
-			}else if( connector == "||" ){
+				return true ;
+			}
+		}
+
+		return false ;
+
+	case type::containsAll :
+
+		for( const auto& it : m_texts ){
+
+			if( !line.contains( it ) ){
 
-				return a || b ;
-			}else{
 				return false ;
 			}
-		}else{
-			return false ;
 		}
+
+		return true ;
+
+	case type::none :
+
+		return false ;
 	}
+
+	return false ;
 }
 
-static bool _skip_line( const QByteArray& line,const engines::engine& engine )
+engines::engine::condition::condition( const QJsonObject& obj )
 {
-	if( line.isEmpty() ){
+	auto connector = obj.value( "Connector" ).toString() ;
 
-		return true ;
-	}else{
-		for( const auto& it : engine.skiptLineWithText() ){
+	auto lhs = obj.value( "lhs" ) ;
+	auto rhs = obj.value( "rhs" ) ;
 
-			if( line.contains( it.toUtf8() ) ){
+	if( connector.isEmpty() ){
 
-				return true ;
-			}
+		if( lhs.isObject() ){
+
+			m_connector = condition::connector::none ;
+			m_lhs = lhs ;
 		}
 
+	}else if( lhs.isObject() && rhs.isObject() ){
+
+		if( connector == "&&" ){
+
+			m_connector = condition::connector::And ;
+
+		}else if( connector == "||" ){
+
+			m_connector = condition::connector::Or ;
+		}
+
+		m_lhs = lhs ;
+		m_rhs = rhs ;
+	}
+}
+
+template< typename ... Line >
+bool engines::engine::condition::_match( const Line& ... line ) const
+{
+	switch( m_connector ){
+
+	case condition::connector::none :
+
+		return m_lhs.match( line ... ) ;
+
+	case condition::connector::And :
+
+		return m_lhs.match( line ... ) && m_rhs.match( line ... ) ;
+
+	case condition::connector::Or :
+
+		return m_lhs.match( line ... ) || m_rhs.match( line ... ) ;
+
+	case condition::connector::invalid :
+
 		return false ;
 	}
+
+	return false ;
 }
 
-static void _add( const QByteArray& data,
-		  QChar token,
-		  const engines::engine& engine,
-		  Logger::Data& outPut,
-		  int id )
+bool engines::engine::condition::match( const QString& line ) const
 {
-	for( const auto& e : utility::split( data,token ) ){
+	return this->_match( line ) ;
+}
 
-		if( _skip_line( e,engine ) ){
+bool engines::engine::condition::match( const char * line,int size ) const
+{
+	return this->_match( line,size ) ;
+}
 
-			continue ;
+static bool _meet_condition( const engines::engine& engine,const QString& line )
+{
+	return engine.controlStructure().match( line ) ;
+}
 
-		}else if( _meet_condition( engine,e ) ){
+namespace
+{
+	/*
+	 * A line in a chunk of process output, it does not own its bytes.
+	 */
+	class lineView
+	{
+	public:
+		lineView( const char * data,int size ) :
+			m_data( data ),
+			m_size( size )
+		{
+		}
+		const char * data() const
+		{
+			return m_data ;
+		}
+		int size() const
+		{
+			return m_size ;
+		}
+		bool isEmpty() const
+		{
+			return m_size == 0 ;
+		}
+		bool startsWith( const char * e ) const
+		{
+			auto s = static_cast< int >( std::strlen( e ) ) ;
 
-			if( id == -1 ){
+			return m_size >= s && std::equal( e,e + s,m_data ) ;
+		}
+		QString toString() const
+		{
+			return QString::fromUtf8( m_data,m_size ) ;
+		}
+	private:
+		const char * m_data ;
+		int m_size ;
+	} ;
+}
 
-				if( outPut.isEmpty() ){
+static bool _meet_condition( const engines::engine& engine,const lineView& line )
+{
+	return engine.controlStructure().match( line.data(),line.size() ) ;
+}
 
-					outPut.add( e ) ;
-				}else{
-					auto& s = outPut.lastText() ;
+static bool _skip_line( const lineView& line,const engines::engine& engine )
+{
+	if( line.isEmpty() ){
 
-					if( _meet_condition( engine,s ) ){
+		return true ;
+	}else{
+		return engine.skiptLineWithText().foundIn( line.data(),line.size() ) ;
+	}
+}
 
-						outPut.replaceLast( e ) ;
-					}else{
-						outPut.add( e ) ;
-					}
-				}
-			}else{
-				auto s = static_cast< bool( * )( const engines::engine&,const QString& ) >( _meet_condition ) ;
+static bool _completed( const engines::engine& engine,const lineView& e )
+{
+	return engine.likeYoutubeDl() && e.startsWith( "[download] 100.0%" ) ;
+}
 
-				outPut.replaceOrAdd( engine,e,id,s,[ &engine ]( const QString& e ){
+static void _add( const QString& e,bool meetCondition,const engines::engine& engine,Logger::Data& outPut,int id )
+{
+	if( meetCondition ){
 
-					if( engine.likeYoutubeDl() ){
+		if( id == -1 ){
 
-						return e.startsWith( "[download] 100.0%" ) ;
-					}else{
-						return false ;
-					}
-				} ) ;
+			if( outPut.isEmpty() ){
+
+				outPut.add( e ) ;
+			}else{
+				auto& s = outPut.lastText() ;
+
+				if( _meet_condition( engine,s ) ){
+
+					outPut.replaceLast( e ) ;
+				}else{
+					outPut.add( e ) ;
+				}
 			}
 		}else{
-			outPut.add( e,id ) ;
+			auto s = static_cast< bool( * )( const engines::engine&,const QString& ) >( _meet_condition ) ;
+
+			outPut.replaceOrAdd( engine,e,id,s,[ &engine ]( const QString& e ){
+
+				if( engine.likeYoutubeDl() ){
+
+					return e.startsWith( "[download] 100.0%" ) ;
+				}else{
+					return false ;
+				}
+			} ) ;
 		}
+	}else{
+		outPut.add( e,id ) ;
 	}
 }
 
@@ -785,28 +1206,75 @@ void engines::engine::functions::processData( const engines::engine& engine,
 					      QByteArray data,
 					      int id )
 {
-	for( const auto& it : engine.removeText() ){
-
-		data.replace( it.toUtf8(),"" ) ;
-	}
+	engine.removeText().removeFrom( data ) ;
 
 	const auto& sp = engine.splitLinesBy() ;
 
+	/*
+	 * Splitting on the first separator and then splitting every part on
+	 * the second one gives the same lines as splitting on either one.
+	 */
+	char separators[ 2 ] ;
+	int separatorsCount ;
+
 	if( sp.size() == 1 && sp[ 0 ].size() > 0 ){
 
-		_add( data,sp[ 0 ][ 0 ],engine,outPut,id ) ;
+		separators[ 0 ] = sp[ 0 ][ 0 ].toLatin1() ;
+		separatorsCount = 1 ;
 
 	}else if( sp.size() == 2 && sp[ 0 ].size() > 0 && sp[ 1 ].size() > 0 ){
 
-		for( const auto& m : utility::split( data,sp[ 0 ][ 0 ] ) ){
+		separators[ 0 ] = sp[ 0 ][ 0 ].toLatin1() ;
+		separators[ 1 ] = sp[ 1 ][ 0 ].toLatin1() ;
+		separatorsCount = 2 ;
+	}else{
+		separators[ 0 ] = '\r' ;
+		separators[ 1 ] = '\n' ;
+		separatorsCount = 2 ;
+	}
+
+	std::vector< std::pair< lineView,bool > > lines ;
+
+	const auto begin = data.constData() ;
+	const auto end = begin + data.size() ;
+
+	auto start = begin ;
 
-			_add( m,sp[ 1 ][ 0 ],engine,outPut,id ) ;
+	for( auto it = begin ; ; it++ ){
+
+		if( it == end || std::find( separators,separators + separatorsCount,*it ) != separators + separatorsCount ){
+
+			lineView line( start,static_cast< int >( it - start ) ) ;
+
+			if( !_skip_line( line,engine ) ){
+
+				lines.emplace_back( line,_meet_condition( engine,line ) ) ;
+			}
+
+			if( it == end ){
+
+				break ;
+			}
+
+			start = it + 1 ;
 		}
-	}else{
-		for( const auto& m : utility::split( data,'\r' ) ){
+	}
+
+	for( size_t i = 0 ; i < lines.size() ; i++ ){
+
+		const auto& line = lines[ i ].first ;
+		auto meetCondition = lines[ i ].second ;
 
-			_add( m,'\n',engine,outPut,id ) ;
+		if( meetCondition && i + 1 < lines.size() && lines[ i + 1 ].second && !_completed( engine,line ) ){
+
+			/*
+			 * The next line replaces this one, do not bother
+			 * turning it into a QString.
+			 */
+			continue ;
 		}
+
+		_add( line.toString(),meetCondition,engine,outPut,id ) ;
 	}
 }
 
@@ -837,8 +1305,10 @@ QByteArray engines::file::readAll()
 	}
 }
 
-const QString& engines::engine::functions::filter::operator()( const engines::engine&,const QString& e )
+const QString& engines::engine::functions::filter::operator()( const engines::engine& engine,const QString& e )
 {
+	m_event = engine.parseOutput( e ) ;
+
 	return e ;
 }
 
@@ -24,11 +24,13 @@
 #include <QStandardPaths>
 #include <QPlainTextEdit>
 #include <QJsonObject>
+#include <QJsonValue>
 #include <QJsonDocument>
 #include <QDir>
 #include <QProcess>
 
 #include <vector>
+#include <array>
 #include <functional>
 #include <memory>
 
@@ -224,26 +226,216 @@ public:
 			QStringList m_options ;
 		} ;
 
+		/*
+		 * Aho-Corasick automaton over the utf-8 bytes of a list of
+		 * strings, a line is searched for all of them in one pass.
+		 * Copies share the automaton.
+		 */
+		class textMatcher
+		{
+		public:
+			textMatcher()
+			{
+			}
+			textMatcher( const QStringList& ) ;
+			bool foundIn( const QByteArray& e ) const
+			{
+				return this->foundIn( e.constData(),e.size() ) ;
+			}
+			bool foundIn( const char * data,int size ) const ;
+			/*
+			 * Where matches overlap, the one that starts first wins
+			 * and of those starting at the same place the longest.
+			 */
+			void removeFrom( QByteArray& ) const ;
+		private:
+			int longestAt( const char * data,int size,int position ) const ;
+			struct node
+			{
+				node()
+				{
+					next.fill( -1 ) ;
+				}
+				std::array< int,256 > next ;
+				int fail = 0 ;
+				int match = 0 ;
+				int depth = 0 ;
+			} ;
+			std::shared_ptr< const std::vector< node > > m_nodes ;
+			int m_maxLength = 0 ;
+			bool m_hasEmptyText = false ;
+		} ;
+
+		/*
+		 * "ControlJsonStructure" compiled once when the engine is
+		 * loaded, matching a line does not touch json.
+		 */
+		class condition
+		{
+		public:
+			condition()
+			{
+			}
+			condition( const QJsonObject& ) ;
+			bool match( const QString& line ) const ;
+			/*
+			 * Matches utf-8 bytes of a line without converting them.
+			 */
+			bool match( const char * line,int size ) const ;
+		private:
+			template< typename ... Line >
+			bool _match( const Line& ... ) const ;
+			class predicate
+			{
+			public:
+				enum class type{ startsWith,endsWith,contains,containsAny,containsAll,none } ;
+
+				predicate() : m_type( type::none )
+				{
+				}
+				predicate( const QJsonValue& ) ;
+				bool match( const QString& line ) const ;
+				bool match( const char * line,int size ) const ;
+			private:
+				type m_type ;
+				QString m_text ;
+				QStringList m_texts ;
+				QByteArray m_utf8Text ;
+				QList< QByteArray > m_utf8Texts ;
+			} ;
+
+			enum class connector{ none,And,Or,invalid } ;
+
+			connector m_connector = connector::invalid ;
+			predicate m_lhs ;
+			predicate m_rhs ;
+		} ;
+
 		struct functions
 		{
+			/*
+			 * What a line of engine output means, worked out once so
+			 * nothing else has to look at the text again.
+			 */
+			class event
+			{
+			public:
+				enum class type{ none,started,destination,progress,merging,completed,error } ;
+
+				event()
+				{
+				}
+				event( event::type t,const QString& text = QString() ) :
+					m_type( t ),
+					m_text( text )
+				{
+				}
+				/*
+				 * Sizes are in bytes, speed is in bytes per second and eta
+				 * is in seconds. A value of -1 means it is not known.
+				 *
+				 * progress is a part of the line, the line is shared and
+				 * not copied so a progress update makes no new string.
+				 */
+				event( const QStringRef& progress,qint64 bytes,qint64 total,qint64 speed,qint64 eta ) :
+					m_type( event::type::progress ),
+					m_text( progress.string() ? *progress.string() : QString() ),
+					m_position( progress.position() ),
+					m_length( progress.size() ),
+					m_bytes( bytes ),
+					m_total( total ),
+					m_speed( speed ),
+					m_eta( eta )
+				{
+				}
+				event::type what() const
+				{
+					return m_type ;
+				}
+				/*
+				 * The file name for destination, merging and completed,
+				 * the message for error and the whole line for progress.
+				 */
+				const QString& text() const
+				{
+					return m_text ;
+				}
+				/*
+				 * The part of the line that describes the progress.
+				 */
+				QStringRef progressText() const
+				{
+					return m_text.midRef( m_position,m_length ) ;
+				}
+				qint64 bytes() const
+				{
+					return m_bytes ;
+				}
+				qint64 total() const
+				{
+					return m_total ;
+				}
+				qint64 speed() const
+				{
+					return m_speed ;
+				}
+				qint64 eta() const
+				{
+					return m_eta ;
+				}
+			private:
+				event::type m_type = event::type::none ;
+				QString m_text ;
+				int m_position = 0 ;
+				int m_length = -1 ;
+				qint64 m_bytes = -1 ;
+				qint64 m_total = -1 ;
+				qint64 m_speed = -1 ;
+				qint64 m_eta = -1 ;
+			} ;
+
 			class filter{
 			public:
 				virtual const QString& operator()( const engines::engine&,const QString& e ) ;
+				/*
+				 * The event of the line last given to operator().
+				 */
+				const engines::engine::functions::event& lastEvent() const
+				{
+					return m_event ;
+				}
 				virtual ~filter() ;
+			protected:
+				engines::engine::functions::event m_event ;
 			} ;
 
 			virtual ~functions() ;
 
+			virtual engines::engine::functions::event parseOutput( const engines::engine&,const QString& line ) ;
+
+			/*
+			 * Called on a background thread with every line before it
+			 * is logged, returns true after removing from the line what
+			 * only parseOutput() is meant to see.
+			 */
+			virtual bool stripParserText( QString& line ) ;
+
 			virtual std::unique_ptr< engines::engine::functions::filter > Filter() ;
 
 			virtual void updateOptions( QJsonObject&,settings& ) ;
 
 			virtual QString commandString( const engines::engine::exeArgs::cmd& ) ;
 
-		        virtual void sendCredentials( const engines::engine&,
-		                                      const QString&,
-						      QProcess& ) ;
+			/*
+			 * What is written to the engine's stdin to log in, an
+			 * empty result writes nothing.
+			 */
+			virtual QByteArray credentials( const engines::engine&,const QString& ) ;
 
+			/*
+			 * Called on a background thread, implementations must
+			 * only read engine state.
+			 */
 			virtual void processData( const engines::engine& engine,
 						  Logger::Data&,
 						  QByteArray,
@@ -306,6 +498,14 @@ public:
 		{
 			return m_defaultDownLoadCmdOptions ;
 		}
+		engines::engine::functions::event parseOutput( const QString& line ) const
+		{
+			return m_functions->parseOutput( *this,line ) ;
+		}
+		bool stripParserText( QString& line ) const
+		{
+			return m_functions->stripParserText( line ) ;
+		}
 		std::unique_ptr< engines::engine::functions::filter > filter() const
 		{
 			return m_functions->Filter() ;
@@ -317,19 +517,29 @@ public:
 		{
 		        m_functions->updateDownLoadCmdOptions( *this,quality,userOptions,urls,ourOptions ) ;
 		}
+		QByteArray credentials( const QString& credentials ) const
+		{
+			return m_functions->credentials( *this,credentials ) ;
+		}
 		void sendCredentials( const QString& credentials,QProcess& exe ) const
 		{
-			m_functions->sendCredentials( *this,credentials,exe ) ;
+			auto m = this->credentials( credentials ) ;
+
+			if( !m.isEmpty() ){
+
+				exe.write( m ) ;
+				exe.closeWriteChannel() ;
+			}
 		}
 		const QStringList& defaultListCmdOptions() const
 		{
 			return m_defaultListCmdOptions ;
 		}
-		const QStringList& skiptLineWithText() const
+		const engines::engine::textMatcher& skiptLineWithText() const
 		{
 			return m_skiptLineWithText ;
 		}
-		const QStringList& removeText() const
+		const engines::engine::textMatcher& removeText() const
 		{
 			return m_removeText ;
 		}
@@ -345,6 +555,40 @@ public:
 		{
 			return m_batchFileArgument ;
 		}
+		/*
+		 * Text of the line the engine prints when it starts on the next
+		 * url of a batch file, empty if it prints no such line.
+		 */
+		const QString& batchFileUrlMarker() const
+		{
+			return m_batchFileUrlMarker ;
+		}
+		/*
+		 * Field of the info json that holds the url as it was given,
+		 * empty if the engine has no such field.
+		 */
+		const QString& infoJsonUrlField() const
+		{
+			return m_infoJsonUrlField ;
+		}
+		/*
+		 * Empty if the engine can not start a download from info json.
+		 */
+		const QString& loadInfoJsonArgument() const
+		{
+			return m_loadInfoJsonArgument ;
+		}
+		/*
+		 * Jobs with the same key count against the same per host limit.
+		 */
+		QString concurrencyKey( const QString& url ) const ;
+		/*
+		 * 0 means no limit of its own.
+		 */
+		int maxConcurrentDownloads() const
+		{
+			return m_maxConcurrentDownloads ;
+		}
 		const QString& exeFolderPath() const
 		{
 			return m_exeFolderPath ;
@@ -369,7 +613,7 @@ public:
 		{
 			return m_playlistItemsArgument ;
 		}
-		const QJsonObject& controlStructure() const
+		const engines::engine::condition& controlStructure() const
 		{
 			return m_controlStructure ;
 		}
@@ -397,9 +641,17 @@ public:
 		{
 			return m_mainEngine ;
 		}
+		/*
+		 * Downloads go to long lived python processes of workerPool
+		 * instead of a new process each.
+		 */
+		bool useWorkerProcesses() const
+		{
+			return m_useWorkerProcesses ;
+		}
 	private:
 		QJsonObject m_jsonObject ;
-		std::unique_ptr< engines::engine::functions > m_functions ;
+		std::shared_ptr< engines::engine::functions > m_functions ;
 		int m_line ;
 		int m_position ;
 		bool m_valid ;
@@ -407,6 +659,8 @@ public:
 		bool m_canDownloadPlaylist ;
 		bool m_likeYoutubeDl ;
 		bool m_mainEngine ;
+		bool m_useWorkerProcesses ;
+		int m_maxConcurrentDownloads ;
 		QString m_name ;
 		QString m_commandName ;
 		QString m_commandNameWindows ;
@@ -419,13 +673,17 @@ public:
 		QString m_playListUrlPrefix ;
 		QString m_playlistItemsArgument ;
 		QString m_batchFileArgument ;
+		QString m_batchFileUrlMarker ;
+		QString m_infoJsonUrlField ;
+		QString m_loadInfoJsonArgument ;
+		QString m_concurrencyKey ;
 		QStringList m_playListIdArguments ;
 		QStringList m_splitLinesBy ;
-		QStringList m_removeText ;
-		QStringList m_skiptLineWithText ;
+		engines::engine::textMatcher m_removeText ;
+		engines::engine::textMatcher m_skiptLineWithText ;
 		QStringList m_defaultDownLoadCmdOptions ;
 		QStringList m_defaultListCmdOptions ;
-		QJsonObject m_controlStructure ;
+		engines::engine::condition m_controlStructure ;
 		exeArgs m_exePath ;
 	};
 	QString findExecutable( const QString& exeName ) const ;
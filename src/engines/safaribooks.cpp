@@ -117,28 +117,29 @@ QString safaribooks::commandString( const engines::engine::exeArgs::cmd& cmd )
 	return m ;
 }
 
-void safaribooks::sendCredentials( const engines::engine& engine,
-				   const QString& credentials,
-				   QProcess& exe )
+QByteArray safaribooks::credentials( const engines::engine& engine,const QString& credentials )
 {
 	if( utility::platformIsNOTWindows() ){
 
 		if( credentials.isEmpty() ){
 
-			exe.write( engine.userName().toUtf8() + "\n" ) ;
-			exe.write( engine.password().toUtf8() + "\n" ) ;
+			return engine.userName().toUtf8() + "\n" + engine.password().toUtf8() + "\n" ;
 		}else{
 			auto m = utility::split( credentials,':',true ) ;
 
 			if( m.size() > 1 ){
 
-				exe.write( m.at( 0 ).toUtf8() + "\n" ) ;
-				exe.write( m.at( 1 ).toUtf8() + "\n" ) ;
+				return m.at( 0 ).toUtf8() + "\n" + m.at( 1 ).toUtf8() + "\n" ;
+			}else{
+				/*
+				 * Empty answers so the prompts fail instead of waiting.
+				 */
+				return "\n\n" ;
 			}
 		}
-
-		exe.closeWriteChannel() ;
 	}
+
+	return QByteArray() ;
 }
 
 void safaribooks::updateDownLoadCmdOptions( const engines::engine& engine,
@@ -27,9 +27,7 @@ public:
 	~safaribooks() override ;
 	void updateOptions( QJsonObject&,settings& ) override ;
 	QString commandString( const engines::engine::exeArgs::cmd& ) override ;
-	void sendCredentials( const engines::engine& engine,
-			      const QString&,
-			      QProcess& ) override ;
+	QByteArray credentials( const engines::engine& engine,const QString& ) override ;
 	void updateDownLoadCmdOptions( const engines::engine& engine,
 				       const QString& quality,
 				       const QStringList& userOptions,
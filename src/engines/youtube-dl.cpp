@@ -26,6 +26,9 @@
 #include "../networkAccess.h"
 #include "../utility.h"
 
+#include <array>
+#include <cstring>
+
 static QJsonObject _defaultControlStructure()
 {
 	QJsonObject obj ;
@@ -202,8 +205,73 @@ void youtube_dl::updateOptions( QJsonObject& object,settings& settings )
 	}
 
 	object.insert( "UsePrivateExecutable",!settings.useSystemProvidedVersionIfAvailable() ) ;
+
+	/*
+	 * Only yt-dlp knows --progress-template, set this to false in the
+	 * engine's json file if the yt-dlp binary in use is too old for it.
+	 */
+	if( !object.contains( "UseProgressTemplate" ) ){
+
+		object.insert( "UseProgressTemplate",object.value( "Name" ).toString() == "yt-dlp" ) ;
+	}
+
+	m_useProgressTemplate = object.value( "UseProgressTemplate" ).toBool() ;
+
+	/*
+	 * yt-dlp starts every url with "[extractor] Extracting URL: <url>",
+	 * youtube-dl has no such line and gets one process per url.
+	 */
+	if( !object.contains( "BatchFileUrlMarker" ) ){
+
+		if( object.value( "Name" ).toString() == "yt-dlp" ){
+
+			object.insert( "BatchFileUrlMarker","Extracting URL: " ) ;
+		}else{
+			object.insert( "BatchFileUrlMarker","" ) ;
+		}
+	}
+
+	/*
+	 * yt-dlp keeps the url it was given in "original_url", youtube-dl only
+	 * has the canonical "webpage_url" and so gets one url per query.
+	 */
+	if( !object.contains( "InfoJsonUrlField" ) ){
+
+		if( object.value( "Name" ).toString() == "yt-dlp" ){
+
+			object.insert( "InfoJsonUrlField","original_url" ) ;
+		}else{
+			object.insert( "InfoJsonUrlField","" ) ;
+		}
+	}
+
+	if( !object.contains( "LoadInfoJsonArgument" ) ){
+
+		object.insert( "LoadInfoJsonArgument","--load-info-json" ) ;
+	}
+
+	/*
+	 * Only works when python can import the backend, off until asked for.
+	 */
+	if( !object.contains( "UseWorkerProcesses" ) ){
+
+		object.insert( "UseWorkerProcesses",false ) ;
+	}
 }
 
+/*
+ * Looks like the usual progress line so ControlJsonStructure and the log work
+ * as before, with the numbers appended in a form that does not need guessing.
+ */
+static const char * _progressTemplate = "download:[download] %(progress._percent_str)s of "
+					 "%(progress._total_bytes_str)s at %(progress._speed_str)s "
+					 "ETA %(progress._eta_str)s [progress:%(progress.status)s,"
+					 "%(progress.downloaded_bytes)s,%(progress.total_bytes)s,"
+					 "%(progress.total_bytes_estimate)s,%(progress.speed)s,"
+					 "%(progress.eta)s]" ;
+
+static const char * _progressTemplateMarker = " [progress:" ;
+
 std::unique_ptr< engines::engine::functions::filter > youtube_dl::Filter()
 {
 	return std::make_unique< youtube_dl::youtube_dlFilter >() ;
@@ -222,6 +290,17 @@ void youtube_dl::updateDownLoadCmdOptions( const engines::engine& engine,
 		ourOptions.removeAll( "--no-playlist" ) ;
 	}
 
+	if( m_useProgressTemplate && !userOptions.contains( "--progress-template" ) ){
+
+		if( !ourOptions.contains( "--newline" ) ){
+
+			ourOptions.append( "--newline" ) ;
+		}
+
+		ourOptions.append( "--progress-template" ) ;
+		ourOptions.append( _progressTemplate ) ;
+	}
+
 	ourOptions.append( engine.optionsArgument() ) ;
 
 	if( quality.isEmpty() ){
@@ -234,43 +313,49 @@ void youtube_dl::updateDownLoadCmdOptions( const engines::engine& engine,
 
 youtube_dl::youtube_dlFilter::youtube_dlFilter() :
 	m_counter( 0 ),
-	m_processing( QObject::tr( "Processing" ) ),
 	m_downloadCompleted( QObject::tr( "Download completed" ) )
 {
+	auto m = QObject::tr( "Processing" ) ;
+
+	for( int i = 0 ; i < 8 ; i++ ){
+
+		m += " ..." ;
+
+		m_processing.append( m ) ;
+	}
 }
 
-const QString& youtube_dl::youtube_dlFilter::operator()( const engines::engine&,
+const QString& youtube_dl::youtube_dlFilter::operator()( const engines::engine& engine,
 							 const QString& e )
 {
-	if( e.contains( " has already been downloaded and merged" ) ){
+	m_event = engine.parseOutput( e ) ;
 
-		m_tmp = e ;
-		m_tmp.replace( " has already been downloaded and merged","" ) ;
-		m_tmp.replace( "[download] ","" ) ;
-		m_tmp_name = m_tmp ;
-		m_tmp += "\n" + m_downloadCompleted ;
+	using type = engines::engine::functions::event::type ;
 
-		m_final = m_tmp ;
+	if( m_event.what() != type::progress ){
 
-		return m_tmp ;
+		m_state = state::other ;
+	}
 
-	}else if( e.contains( " has already been downloaded" ) ){
+	switch( m_event.what() ){
 
-		m_tmp = e ;
-		m_tmp.replace( " has already been downloaded","" ) ;
-		m_tmp.replace( "[download] ","" ) ;
-		m_tmp_name = m_tmp ;
-		m_tmp += "\n" + m_downloadCompleted ;
+	case type::completed :
 
-		m_final = m_tmp ;
+		if( m_event.text().isEmpty() ){
 
-		return m_tmp ;
+			if( !m_name.isEmpty() ){
 
-	}else if( e.contains( "[Merger] Merging formats into " ) ){
+				m_final = m_name + "\n" + m_downloadCompleted ;
 
-		m_tmp = e ;
-		m_tmp.replace( "[Merger] Merging formats into ","" ) ;
-		m_tmp.truncate( m_name.size() - 1 ) ;
+			}else if( !m_tmp_name.isEmpty() ){
+
+				m_final = m_tmp_name + "\n" + m_downloadCompleted ;
+			}
+
+			return m_final ;
+		}
+
+		m_tmp = m_event.text() ;
 		m_tmp_name = m_tmp ;
 		m_tmp += "\n" + m_downloadCompleted ;
 
@@ -278,10 +363,14 @@ const QString& youtube_dl::youtube_dlFilter::operator()( const engines::engine&,
 
 		return m_tmp ;
 
-	}else if( e.contains( "[ffmpeg] Merging formats into " ) ){
+	case type::merging :
+
+		if( m_event.text().isEmpty() ){
+
+			return m_final ;
+		}
 
-		m_tmp = e ;
-		m_tmp.replace( "[ffmpeg] Merging formats into ","" ) ;
+		m_tmp = m_event.text() ;
 		m_tmp.truncate( m_name.size() - 1 ) ;
 		m_tmp_name = m_tmp ;
 		m_tmp += "\n" + m_downloadCompleted ;
@@ -290,74 +379,456 @@ const QString& youtube_dl::youtube_dlFilter::operator()( const engines::engine&,
 
 		return m_tmp ;
 
-	}else if( e.startsWith( "[download]  " ) && e.contains( " ETA " ) ){
+	case type::progress :
+	{
+		/*
+		 * Built in one buffer, this branch runs for every progress update.
+		 */
+		const auto& name = m_name.isEmpty() ? m_tmp_name : m_name ;
+
+		auto progress = m_event.progressText() ;
+
+		if( m_state == state::progress && progress == m_progress && name == m_progressName ){
+
+			return m_tmp ;
+		}
+
+		m_state = state::progress ;
 
-		m_tmp = e ;
-		m_tmp.replace( "[download]  ","" ) ;
+		m_progress.resize( 0 ) ;
+		m_progress.append( progress ) ;
 
-		if( !m_name.isEmpty() ){
+		m_progressName = name ;
 
-			m_tmp = m_name + "\n" + m_tmp ;
+		m_tmp.clear() ;
+		m_tmp.reserve( name.size() + 1 + progress.size() ) ;
 
-		}else if( !m_tmp_name.isEmpty() ){
+		if( !name.isEmpty() ){
 
-			m_tmp = m_tmp_name + "\n" + m_tmp ;
+			m_tmp += name ;
+			m_tmp += '\n' ;
 		}
 
+		m_tmp += progress ;
+
 		return m_tmp ;
+	}
+	case type::destination :
 
-	}else if( e.startsWith( "[download] 100% of " ) ){
+		m_name = m_event.text() ;
 
-		if( !m_name.isEmpty() ){
+		return this->processing() ;
+
+	case type::error :
 
-			m_final = m_name + "\n" + m_downloadCompleted ;
+		return e ;
 
-		}else if( !m_tmp_name.isEmpty() ){
+	case type::started :
+	case type::none :
 
-			m_final = m_tmp_name + "\n" + m_downloadCompleted ;
+		if( m_final.isEmpty() ){
+
+			return this->processing() ;
+		}else{
+			return m_final ;
 		}
+	}
 
-		return m_final ;
+	return e ;
+}
 
-	}else if( e.startsWith( "[ffmpeg] " ) || e.startsWith( "[Merger] " ) ){
+/*
+ * Progress lines are parsed in place, the helpers below take parts of the line
+ * and make no new strings.
+ */
+static QStringRef _trimmed( const QStringRef& e )
+{
+	int start = 0 ;
+	int end = e.size() ;
 
-		return m_final ;
+	while( start < end && e.at( start ).isSpace() ){
 
-	}else if( e.startsWith( "[download] Destination:" ) ){
+		start++ ;
+	}
 
-		m_name = e ;
-		m_name.replace( "[download] Destination: ","" ) ;
-		return this->processing() ;
-	}else{
-		if( e.startsWith( "ERROR: " ) ){
+	while( end > start && e.at( end - 1 ).isSpace() ){
 
-			return e ;
-		}else{
-			if( m_final.isEmpty() ){
+		end-- ;
+	}
+
+	return e.mid( start,end - start ) ;
+}
+
+static qint64 _size( QStringRef m )
+{
+	if( m.startsWith( '~' ) ){
+
+		m = m.mid( 1 ) ;
+	}
+
+	struct unit{ const char * name ; double size ; } ;
 
-				return this->processing() ;
+	static const unit units[] = { { "TiB",1099511627776.0 },
+				      { "GiB",1073741824.0 },
+				      { "MiB",1048576.0 },
+				      { "KiB",1024.0 },
+				      { "B",1.0 } } ;
+
+	for( const auto& it : units ){
+
+		if( m.endsWith( QLatin1String( it.name ) ) ){
+
+			bool ok ;
+
+			auto s = m.left( m.size() - static_cast< int >( std::strlen( it.name ) ) ).toDouble( &ok ) ;
+
+			if( ok ){
+
+				return static_cast< qint64 >( s * it.size ) ;
 			}else{
-				return m_final ;
+				return -1 ;
 			}
 		}
 	}
+
+	return -1 ;
 }
 
-youtube_dl::youtube_dlFilter::~youtube_dlFilter()
+static qint64 _eta( const QStringRef& e )
 {
+	qint64 m = 0 ;
+	int start = 0 ;
+
+	while( start <= e.size() ){
+
+		auto end = e.indexOf( ':',start ) ;
+
+		if( end == -1 ){
+
+			end = e.size() ;
+		}
+
+		if( end > start ){
+
+			bool ok ;
+
+			auto s = e.mid( start,end - start ).toLongLong( &ok ) ;
+
+			if( !ok ){
+
+				return -1 ;
+			}
+
+			m = m * 60 + s ;
+		}
+
+		start = end + 1 ;
+	}
+
+	return m ;
 }
 
-const QString& youtube_dl::youtube_dlFilter::processing()
+/*
+ * Parses the part of line e that starts at position start and looks like:
+ * "42.3% of ~10.00MiB at  1.00MiB/s ETA 00:10"
+ */
+static engines::engine::functions::event _progress( const QString& e,int start )
+{
+	std::array< QStringRef,16 > m ;
+
+	int count = 0 ;
+	int end = start ;
+
+	while( count < static_cast< int >( m.size() ) ){
+
+		while( start < e.size() && e.at( start ) == ' ' ){
+
+			start++ ;
+		}
+
+		if( start == e.size() ){
+
+			break ;
+		}
+
+		end = e.indexOf( ' ',start ) ;
+
+		if( end == -1 ){
+
+			end = e.size() ;
+		}
+
+		m[ static_cast< size_t >( count++ ) ] = e.midRef( start,end - start ) ;
+
+		start = end ;
+	}
+
+	double percent = -1 ;
+	qint64 total = -1 ;
+	qint64 speed = -1 ;
+	qint64 eta = -1 ;
+
+	for( int i = 0 ; i < count ; i++ ){
+
+		const auto& it = m[ static_cast< size_t >( i ) ] ;
+
+		if( it.endsWith( '%' ) ){
+
+			bool ok ;
+
+			auto s = it.left( it.size() - 1 ).toDouble( &ok ) ;
+
+			if( ok ){
+
+				percent = s ;
+			}
+
+		}else if( i + 1 < count ){
+
+			const auto& next = m[ static_cast< size_t >( i + 1 ) ] ;
+
+			if( it == QLatin1String( "of" ) ){
+
+				total = _size( next ) ;
+
+			}else if( it == QLatin1String( "at" ) && next.endsWith( QLatin1String( "/s" ) ) ){
+
+				speed = _size( next.left( next.size() - 2 ) ) ;
+
+			}else if( it == QLatin1String( "ETA" ) ){
+
+				eta = _eta( next ) ;
+			}
+		}
+	}
+
+	qint64 bytes = -1 ;
+
+	if( percent >= 0 && total >= 0 ){
+
+		bytes = static_cast< qint64 >( percent * static_cast< double >( total ) / 100 ) ;
+	}
+
+	auto text = count > 0 ? e.midRef( m[ 0 ].position(),end - m[ 0 ].position() ) : QStringRef() ;
+
+	return { text,bytes,total,speed,eta } ;
+}
+
+static qint64 _number( const QStringRef& e )
+{
+	bool ok ;
+
+	auto m = e.toDouble( &ok ) ;
+
+	if( ok && m >= 0 ){
+
+		return static_cast< qint64 >( m ) ;
+	}else{
+		return -1 ;
+	}
+}
+
+/*
+ * Parses a line printed with _progressTemplate, fields that yt-dlp does not
+ * know are printed as "NA".
+ */
+static engines::engine::functions::event _templateProgress( const QString& e,int marker )
+{
+	using event = engines::engine::functions::event ;
+
+	auto start = marker + static_cast< int >( std::strlen( _progressTemplateMarker ) ) ;
+	auto last = e.size() - 1 ;
+
+	std::array< QStringRef,6 > m ;
+
+	size_t count = 0 ;
+
+	while( count < m.size() ){
+
+		auto end = e.indexOf( ',',start ) ;
+
+		if( end == -1 || end > last ){
+
+			end = last ;
+		}
+
+		m[ count++ ] = e.midRef( start,end - start ) ;
+
+		start = end + 1 ;
+
+		if( end == last ){
+
+			break ;
+		}
+	}
+
+	if( count != m.size() || start <= last ){
+
+		return {} ;
+	}
+
+	if( m[ 0 ] == QLatin1String( "finished" ) ){
+
+		return { event::type::completed } ;
+	}
+
+	auto total = _number( m[ 2 ] ) ;
+
+	if( total == -1 ){
+
+		total = _number( m[ 3 ] ) ;
+	}
+
+	auto text = _trimmed( e.midRef( 11,marker - 11 ) ) ;
+
+	return { text,_number( m[ 1 ] ),total,_number( m[ 4 ] ),_number( m[ 5 ] ) } ;
+}
+
+/*
+ * Handles what follows "[download] " in a line.
+ */
+static engines::engine::functions::event _download( const QString& e,int start )
+{
+	using event = engines::engine::functions::event ;
+
+	if( e.endsWith( ']' ) ){
+
+		auto marker = e.lastIndexOf( _progressTemplateMarker ) ;
+
+		if( marker != -1 ){
+
+			return _templateProgress( e,marker ) ;
+		}
+	}
+
+	auto m = e.midRef( start ) ;
+
+	if( m.endsWith( " has already been downloaded and merged" ) ){
+
+		return { event::type::completed,m.left( m.size() - 39 ).toString() } ;
+
+	}else if( m.endsWith( " has already been downloaded" ) ){
+
+		return { event::type::completed,m.left( m.size() - 28 ).toString() } ;
+
+	}else if( m.startsWith( ' ' ) && m.contains( " ETA " ) ){
+
+		return _progress( e,start + 1 ) ;
+
+	}else if( m.startsWith( "100% of " ) ){
+
+		return { event::type::completed } ;
+
+	}else if( m.startsWith( "Destination: " ) ){
+
+		return { event::type::destination,m.mid( 13 ).toString() } ;
+	}else{
+		return { event::type::started } ;
+	}
+}
+
+/*
+ * Handles what follows "[Merger] " and "[ffmpeg] " in a line.
+ */
+static engines::engine::functions::event _postProcessor( const QString& e,int start )
+{
+	using event = engines::engine::functions::event ;
+
+	auto m = e.midRef( start ) ;
+
+	if( m.startsWith( "Merging formats into " ) ){
+
+		return { event::type::merging,m.mid( 21 ).toString() } ;
+	}else{
+		return { event::type::merging } ;
+	}
+}
+
+namespace
+{
+	struct tagHandler
+	{
+		QLatin1String tag ;
+		engines::engine::functions::event( *handle )( const QString&,int ) ;
+	} ;
+}
+
+/*
+ * Lines are dispatched on their leading "[tag]", tags not in here are
+ * extractors working out what to download.
+ */
+static const tagHandler _tagHandlers[] = { { QLatin1String( "download" ),_download },
+					   { QLatin1String( "Merger" ),_postProcessor },
+					   { QLatin1String( "ffmpeg" ),_postProcessor } } ;
+
+engines::engine::functions::event youtube_dl::parseOutput( const engines::engine&,const QString& e )
 {
-	if( m_counter < 8 ){
+	using event = engines::engine::functions::event ;
+
+	if( e.startsWith( '[' ) ){
+
+		auto end = e.indexOf( ']' ) ;
+
+		if( end != -1 ){
 
-		m_processing += " ..." ;
+			auto tag = e.midRef( 1,end - 1 ) ;
+
+			for( const auto& it : _tagHandlers ){
+
+				if( tag == it.tag ){
+
+					/*
+					 * Handlers get the position after "] ".
+					 */
+					return it.handle( e,end + 2 ) ;
+				}
+			}
+		}
+
+		return { event::type::started } ;
+
+	}else if( e.startsWith( "ERROR: " ) ){
+
+		return { event::type::error,e } ;
 	}else{
-		m_counter = 0 ;
-		m_processing = QObject::tr( "Processing" ) + " ..." ;
+		return {} ;
 	}
+}
+
+/*
+ * The numbers after _progressTemplateMarker are for parseOutput(), the log
+ * shows the line as yt-dlp would have printed it.
+ */
+bool youtube_dl::stripParserText( QString& e )
+{
+	if( m_useProgressTemplate && e.endsWith( ']' ) ){
+
+		auto marker = e.lastIndexOf( _progressTemplateMarker ) ;
+
+		if( marker != -1 ){
+
+			e.truncate( marker ) ;
+
+			return true ;
+		}
+	}
+
+	return false ;
+}
+
+youtube_dl::youtube_dlFilter::~youtube_dlFilter()
+{
+}
+
+const QString& youtube_dl::youtube_dlFilter::processing()
+{
+	/*
+	 * "Processing ..." grows by one " ..." a call and starts over after
+	 * eight of them, the strings are made once and reused.
+	 */
+	const auto& m = m_processing[ m_counter ] ;
 
-	m_counter++ ;
+	m_counter = ( m_counter + 1 ) % m_processing.size() ;
 
-	return m_processing ;
+	return m ;
 }
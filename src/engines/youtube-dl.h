@@ -38,9 +38,13 @@ public:
 		virtual ~youtube_dlFilter() override ;
 	private:
 		const QString& processing() ;
+		enum class state{ progress,other } ;
+		state m_state = state::other ;
 		int m_counter ;
 		QString m_tmp ;
-		QString m_processing ;
+		QString m_progress ;
+		QString m_progressName ;
+		QStringList m_processing ;
 		QString m_downloadCompleted ;
 		QString m_final ;
 		QString m_name ;
@@ -49,6 +53,10 @@ public:
 
 	std::unique_ptr< engines::engine::functions::filter > Filter() override ;
 
+	engines::engine::functions::event parseOutput( const engines::engine&,const QString& ) override ;
+
+	bool stripParserText( QString& ) override ;
+
 	void updateDownLoadCmdOptions( const engines::engine& engine,
 				       const QString& quality,
 				       const QStringList& userOptions,
@@ -59,4 +67,5 @@ public:
 	youtube_dl() ;
 	static QJsonObject defaultControlStructure() ;
 private:
+	bool m_useProgressTemplate = false ;
 };
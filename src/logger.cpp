@@ -20,10 +20,74 @@
 #include "logger.h"
 
 #include "engines.h"
+#include "settings.h"
 
-Logger::Logger( QPlainTextEdit& e ) : m_textEdit( e )
+#include <QTextDocument>
+#include <QScrollBar>
+#include <QDir>
+
+#include <algorithm>
+
+/*
+ * History is paged in this many lines at a time, lines evicted while it is
+ * showing push the oldest paged in lines out once there are this many pages.
+ */
+static const int _pageSize = 200 ;
+static const int _maxPagedInLines = 5 * _pageSize ;
+
+Logger::Logger( QPlainTextEdit& e,settings& s ) : m_textEdit( e ),m_lines( true )
 {
 	m_textEdit.setReadOnly( true ) ;
+	m_textEdit.setUndoRedoEnabled( false ) ;
+
+	m_lines.setLimits( s.maxLoggerLines(),s.maxLoggerSize() ) ;
+
+	/*
+	 * Processes can produce hundreds of lines a second, repaint at most
+	 * about 30 times a second with whatever accumulated in between.
+	 */
+	m_timer.setSingleShot( true ) ;
+	m_timer.setInterval( 33 ) ;
+
+	QObject::connect( &m_timer,&QTimer::timeout,[ this ](){
+
+		this->flush() ;
+	} ) ;
+
+	if( s.logHistoryOnDisk() ){
+
+		auto m = s.configPaths() ;
+
+		auto path = m.isEmpty() ? QDir::homePath() + "/.config/media-downloader" : m.first() ;
+
+		QDir().mkpath( path ) ;
+
+		m_history = std::make_unique< Logger::history >( path + "/log_history",s.maxLogHistorySize() ) ;
+
+		m_lines.onEvicted( [ this ]( const QString& e ){
+
+			m_history->add( e ) ;
+		} ) ;
+
+		auto bar = m_textEdit.verticalScrollBar() ;
+
+		QObject::connect( bar,&QScrollBar::valueChanged,[ this,bar ]( int value ){
+
+			if( m_paging || bar->maximum() == bar->minimum() ){
+
+				return ;
+			}
+
+			if( value == bar->minimum() ){
+
+				this->pageIn() ;
+
+			}else if( value == bar->maximum() ){
+
+				this->pageOut() ;
+			}
+		} ) ;
+	}
 }
 
 void Logger::add( const QString& s,int id )
@@ -41,12 +105,442 @@ void Logger::add( const QString& s,int id )
 void Logger::clear()
 {
 	m_lines.clear() ;
+	m_lines.changesApplied() ;
 	m_textEdit.clear() ;
+
+	m_historyLines = 0 ;
+
+	if( m_history ){
+
+		m_history->clear() ;
+	}
 }
 
 void Logger::update()
 {
-	m_textEdit.setPlainText( m_lines.toString() ) ;
+	if( !m_timer.isActive() ){
+
+		m_timer.start() ;
+	}
+}
+
+void Logger::flush()
+{
+	m_timer.stop() ;
+
+	this->updateView() ;
+
+	auto m = std::move( m_updates ) ;
+
+	m_updates.clear() ;
+
+	for( const auto& it : m ){
+
+		it.second() ;
+	}
+}
+
+void Logger::updateView()
+{
+	const auto& changes = m_lines.changes() ;
+
+	if( changes.empty() ){
+
+		return ;
+	}
+
+	if( changes[ 0 ].what() == Logger::Data::change::type::clear ){
+
+		m_paging = true ;
+
+		m_textEdit.setPlainText( m_lines.toString() ) ;
+
+		m_paging = false ;
+
+		m_historyLines = 0 ;
+
+		if( m_history ){
+
+			m_history->rewind() ;
+		}
+	}else{
+		QTextCursor cursor( m_textEdit.document() ) ;
+
+		cursor.beginEditBlock() ;
+
+		for( const auto& it : changes ){
+
+			this->render( cursor,it ) ;
+		}
+
+		cursor.endEditBlock() ;
+	}
+
+	m_lines.changesApplied() ;
+
+	if( m_historyLines == 0 ){
+
+		/*
+		 * Do not yank the view away from history the user is reading.
+		 */
+		m_textEdit.moveCursor( QTextCursor::End ) ;
+	}
+}
+
+void Logger::render( QTextCursor& cursor,const Logger::Data::change& e )
+{
+	using type = Logger::Data::change::type ;
+
+	auto doc = m_textEdit.document() ;
+
+	auto index = static_cast< int >( e.index() ) + m_historyLines ;
+
+	if( e.what() == type::append ){
+
+		if( index == 0 ){
+
+			cursor.movePosition( QTextCursor::Start ) ;
+		}else{
+			cursor.movePosition( QTextCursor::End ) ;
+			cursor.insertBlock() ;
+		}
+
+		cursor.insertText( e.text() ) ;
+
+	}else if( e.what() == type::insert ){
+
+		cursor.setPosition( doc->findBlockByNumber( index ).position() ) ;
+		cursor.insertText( e.text() ) ;
+		cursor.insertBlock() ;
+
+	}else if( e.what() == type::replace ){
+
+		cursor.setPosition( doc->findBlockByNumber( index ).position() ) ;
+		cursor.movePosition( QTextCursor::EndOfBlock,QTextCursor::KeepAnchor ) ;
+		cursor.insertText( e.text() ) ;
+
+	}else if( e.what() == type::removeFirst ){
+
+		if( m_historyLines > 0 ){
+
+			/*
+			 * The line is on disk now and it is already showing as
+			 * part of the history the user paged in, the oldest
+			 * paged in line makes room for it past a few pages.
+			 */
+			if( m_historyLines < _maxPagedInLines ){
+
+				m_historyLines++ ;
+
+				return ;
+			}
+
+			m_history->skip( 1 ) ;
+		}
+
+		auto next = doc->begin().next() ;
+
+		cursor.movePosition( QTextCursor::Start ) ;
+
+		if( next.isValid() ){
+
+			cursor.setPosition( next.position(),QTextCursor::KeepAnchor ) ;
+		}else{
+			cursor.movePosition( QTextCursor::End,QTextCursor::KeepAnchor ) ;
+		}
+
+		cursor.removeSelectedText() ;
+
+	}else if( e.what() == type::removeLast ){
+
+		if( index == 0 ){
+
+			cursor.movePosition( QTextCursor::Start ) ;
+		}else{
+			cursor.setPosition( doc->findBlockByNumber( index ).position() - 1 ) ;
+		}
+
+		cursor.movePosition( QTextCursor::End,QTextCursor::KeepAnchor ) ;
+		cursor.removeSelectedText() ;
+	}
+}
+
+void Logger::pageIn()
+{
+	auto lines = m_history->previous( _pageSize ) ;
+
+	if( lines.isEmpty() ){
+
+		return ;
+	}
+
+	m_paging = true ;
+
+	QTextCursor cursor( m_textEdit.document() ) ;
+
+	cursor.beginEditBlock() ;
+
+	cursor.movePosition( QTextCursor::Start ) ;
+
+	cursor.insertText( lines.join( "\n" ) ) ;
+
+	cursor.insertBlock() ;
+
+	cursor.endEditBlock() ;
+
+	m_historyLines += lines.size() ;
+
+	auto bar = m_textEdit.verticalScrollBar() ;
+
+	bar->setValue( bar->minimum() + lines.size() ) ;
+
+	m_paging = false ;
+}
+
+void Logger::pageOut()
+{
+	if( m_historyLines == 0 ){
+
+		return ;
+	}
+
+	m_paging = true ;
+
+	auto doc = m_textEdit.document() ;
+
+	QTextCursor cursor( doc ) ;
+
+	cursor.movePosition( QTextCursor::Start ) ;
+
+	cursor.setPosition( doc->findBlockByNumber( m_historyLines ).position(),QTextCursor::KeepAnchor ) ;
+
+	cursor.removeSelectedText() ;
+
+	m_historyLines = 0 ;
+
+	m_history->rewind() ;
 
 	m_textEdit.moveCursor( QTextCursor::End ) ;
+
+	m_paging = false ;
+}
+
+Logger::history::history( const QString& path,qint64 maximum ) :
+	m_file( path ),
+	m_maximum( maximum )
+{
+	m_file.open( QIODevice::ReadWrite | QIODevice::Truncate ) ;
+}
+
+void Logger::history::add( const QString& e )
+{
+	/*
+	 * Lines are stored as null terminated utf8 strings so that they can
+	 * be found by walking the file backwards.
+	 */
+	m_file.seek( m_file.size() ) ;
+	m_file.write( e.toUtf8() ) ;
+	m_file.putChar( '\0' ) ;
+
+	if( m_maximum > 0 && m_file.size() > m_maximum ){
+
+		this->compact() ;
+	}
+}
+
+/*
+ * Drops the oldest half of the file. Lines the user paged in can go too,
+ * they stay in the document and are only counted so that skip() still
+ * knows which lines it is moving past.
+ */
+void Logger::history::compact()
+{
+	m_file.flush() ;
+
+	auto size = m_file.size() ;
+
+	auto cut = size - m_maximum / 2 ;
+
+	if( cut <= 0 ){
+
+		return ;
+	}
+
+	/*
+	 * The kept part must start at the start of a line.
+	 */
+	m_file.seek( cut - 1 ) ;
+
+	while( true ){
+
+		auto data = m_file.read( 4096 ) ;
+
+		if( data.isEmpty() ){
+
+			return ;
+		}
+
+		auto s = data.indexOf( '\0' ) ;
+
+		if( s != -1 ){
+
+			cut = m_file.pos() - data.size() + s + 1 ;
+
+			break ;
+		}
+	}
+
+	if( m_position != -1 && cut > m_position ){
+
+		m_file.seek( m_position ) ;
+
+		for( auto remaining = cut - m_position ; remaining > 0 ; ){
+
+			auto data = m_file.read( std::min( remaining,static_cast< qint64 >( 64 * 1024 ) ) ) ;
+
+			if( data.isEmpty() ){
+
+				break ;
+			}
+
+			m_dropped += data.count( '\0' ) ;
+
+			remaining -= data.size() ;
+		}
+
+		m_position = cut ;
+	}
+
+	for( qint64 from = cut ; from < size ; ){
+
+		m_file.seek( from ) ;
+
+		auto data = m_file.read( 1024 * 1024 ) ;
+
+		m_file.seek( from - cut ) ;
+		m_file.write( data ) ;
+
+		from += data.size() ;
+	}
+
+	m_file.resize( size - cut ) ;
+
+	if( m_position != -1 ){
+
+		m_position -= cut ;
+	}
+}
+
+void Logger::history::clear()
+{
+	m_file.resize( 0 ) ;
+	m_file.seek( 0 ) ;
+
+	m_position = -1 ;
+	m_dropped = 0 ;
+}
+
+void Logger::history::rewind()
+{
+	m_position = -1 ;
+	m_dropped = 0 ;
+}
+
+QStringList Logger::history::previous( int count )
+{
+	m_file.flush() ;
+
+	if( m_position == -1 ){
+
+		m_position = m_file.size() ;
+	}
+
+	QStringList m ;
+
+	if( m_position <= 0 ){
+
+		return m ;
+	}
+
+	/*
+	 * Only the part of the file the lines are in is read, a chunk at a
+	 * time going backwards.
+	 */
+	auto start = m_position ;
+
+	QByteArray data ;
+
+	while( start > 0 && data.count( '\0' ) <= count ){
+
+		auto size = std::min( start,static_cast< qint64 >( 64 * 1024 ) ) ;
+
+		start -= size ;
+
+		m_file.seek( start ) ;
+
+		data.prepend( m_file.read( size ) ) ;
+	}
+
+	auto end = data.size() - 1 ;
+
+	for( ; count > 0 && end >= 0 ; count-- ){
+
+		auto s = end > 0 ? data.lastIndexOf( '\0',end - 1 ) : -1 ;
+
+		m.prepend( QString::fromUtf8( data.constData() + s + 1,end - s - 1 ) ) ;
+
+		end = s ;
+	}
+
+	m_position = start + end + 1 ;
+
+	return m ;
+}
+
+void Logger::history::skip( int count )
+{
+	if( m_position == -1 ){
+
+		return ;
+	}
+
+	/*
+	 * The oldest paged in lines may have been compacted away already.
+	 */
+	auto dropped = std::min( count,m_dropped ) ;
+
+	m_dropped -= dropped ;
+	count -= dropped ;
+
+	m_file.flush() ;
+
+	m_file.seek( m_position ) ;
+
+	while( count > 0 ){
+
+		auto data = m_file.read( 4096 ) ;
+
+		if( data.isEmpty() ){
+
+			break ;
+		}
+
+		int s = 0 ;
+
+		while( count > 0 ){
+
+			s = data.indexOf( '\0',s ) ;
+
+			if( s == -1 ){
+
+				break ;
+			}
+
+			s++ ;
+
+			count-- ;
+
+			m_position = m_file.pos() - data.size() + s ;
+		}
+	}
 }
@@ -21,10 +21,24 @@
 #define LOGGER_H
 
 #include <QPlainTextEdit>
+#include <QTextCursor>
+#include <QTextBlock>
 #include <QString>
 #include <QStringList>
 #include <QTableWidgetItem>
 #include <QDebug>
+#include <QFile>
+#include <QTimer>
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <unordered_map>
+#include <map>
+#include <functional>
+#include <memory>
+
+class settings ;
 
 class Logger
 {
@@ -32,6 +46,50 @@ public:
 	class Data
 	{
 	public:
+		class change
+		{
+		public:
+			enum class type{ append,insert,replace,removeFirst,removeLast,clear } ;
+
+			change( change::type t,size_t index,const QString& text ) :
+				m_type( t ),
+				m_index( index ),
+				m_text( text )
+			{
+			}
+			change::type what() const
+			{
+				return m_type ;
+			}
+			size_t index() const
+			{
+				return m_index ;
+			}
+			const QString& text() const
+			{
+				return m_text ;
+			}
+			void replace( const QString& text )
+			{
+				m_text = text ;
+			}
+		private:
+			change::type m_type ;
+			size_t m_index ;
+			QString m_text ;
+		} ;
+
+		Data( bool trackChanges = false ) : m_trackChanges( trackChanges )
+		{
+		}
+		const std::vector< Logger::Data::change >& changes() const
+		{
+			return m_changes ;
+		}
+		void changesApplied()
+		{
+			m_changes.clear() ;
+		}
 		bool isEmpty()
 		{
 			return m_lines.empty() ;
@@ -83,6 +141,11 @@ public:
 		void clear()
 		{
 			m_lines.clear() ;
+			m_index.clear() ;
+			m_offset = 0 ;
+			m_size = 0 ;
+
+			this->changed( change::type::clear,0 ) ;
 		}
 		QString toString()
 		{
@@ -106,11 +169,48 @@ public:
 		}
 		void removeLast()
 		{
+			auto position = m_lines.size() - 1 ;
+
+			const auto& line = m_lines[ position ] ;
+
+			m_size -= line.size() ;
+
+			auto id = line.id() ;
+
 			m_lines.pop_back() ;
+
+			if( id != -1 ){
+
+				this->reIndex( id,position ) ;
+			}
+
+			this->changed( change::type::removeLast,position ) ;
 		}
 		void replaceLast( const QString& e )
 		{
-			m_lines.rbegin()->replace( e ) ;
+			this->replace( m_lines.size() - 1,e ) ;
+		}
+		/*
+		 * Replaces the last line added with id, or the last line when
+		 * id is -1. The line is added if there is nothing to replace.
+		 */
+		void replaceLast( const QString& e,int id )
+		{
+			if( id == -1 ){
+
+				if( this->isEmpty() ){
+
+					this->add( e ) ;
+				}else{
+					this->replaceLast( e ) ;
+				}
+			}else{
+				_replaceOrAdd( 0,
+					       e,
+					       id,
+					       []( const int&,const QString& ){ return true ; },
+					       []( const QString& ){ return false ; } ) ;
+			}
 		}
 		template< typename Function,
 			  typename Add,
@@ -127,6 +227,26 @@ public:
 				       []( const int&,const QString& ){ return false ; },
 				       []( const QString& ){ return false ; } ) ;
 		}
+		/*
+		 * Oldest lines are dropped once either limit is crossed,
+		 * a value of zero means there is no limit.
+		 */
+		void setLimits( size_t maxLines,size_t maxBytes )
+		{
+			m_maxLines = maxLines ;
+			m_maxBytes = maxBytes ;
+
+			this->evict() ;
+		}
+		/*
+		 * Function will be called with the text of every line that is
+		 * dropped because of the limits set above.
+		 */
+		template< typename Function >
+		void onEvicted( Function function )
+		{
+			m_onEvicted = std::move( function ) ;
+		}
 	private:
 		template< typename Function,
 			  typename Add,
@@ -135,37 +255,177 @@ public:
 		{
 			if( id != -1 ){
 
-				for( auto it = m_lines.rbegin() ; it != m_lines.rend() ; it++ ){
+				auto it = m_index.find( id ) ;
 
-					if( it->id() == id ){
+				if( it != m_index.end() ){
 
-						if( function( arg,it->text() ) ){
+					auto position = it->second - m_offset ;
 
-							if( add( it->text() ) ){
+					const auto& e = m_lines[ position ].text() ;
 
-								this->add( it,text,id ) ;
-							}else{
-								it->replace( text ) ;
-							}
-						}else{
-							this->add( it,text,id ) ;
-						}
+					if( function( arg,e ) && !add( e ) ){
+
+						this->replace( position,text ) ;
+					}else{
+						this->insert( position + 1,text,id ) ;
+					}
+
+					return ;
+				}
+			}
+
+			this->insert( m_lines.size(),text,id ) ;
+		}
+		void replace( size_t position,const QString& text )
+		{
+			auto& line = m_lines[ position ] ;
+
+			m_size -= line.size() ;
+
+			line.replace( text ) ;
+
+			m_size += line.size() ;
+
+			this->changed( change::type::replace,position,text ) ;
+
+			this->evict() ;
+		}
+		void insert( size_t position,const QString& text,int id )
+		{
+			if( position == m_lines.size() ){
 
-						return ;
+				m_lines.emplace_back( text,id ) ;
+
+				if( id != -1 ){
+
+					m_index[ id ] = m_offset + position ;
+				}
+
+				this->changed( change::type::append,position,text ) ;
+			}else{
+				m_lines.emplace( m_lines.begin() + static_cast< std::ptrdiff_t >( position ),text,id ) ;
+
+				/*
+				 * Lines after the new one moved down by one. The index
+				 * has one entry per id and not one per line, so only
+				 * the entries of ids further down are touched.
+				 */
+				auto m = m_offset + position ;
+
+				for( auto& it : m_index ){
+
+					if( it.second >= m ){
+
+						it.second++ ;
 					}
 				}
+
+				if( id != -1 ){
+
+					m_index[ id ] = m ;
+				}
+
+				this->changed( change::type::insert,position,text ) ;
 			}
 
-			m_lines.emplace_back( text,id ) ;
+			m_size += m_lines[ position ].size() ;
+
+			this->evict() ;
+		}
+		void evict()
+		{
+			auto _full = [ this ](){
+
+				if( m_maxLines > 0 && m_lines.size() > m_maxLines ){
+
+					return true ;
+				}else{
+					return m_maxBytes > 0 && m_size > m_maxBytes ;
+				}
+			} ;
+
+			while( m_lines.size() > 1 && _full() ){
+
+				const auto& line = m_lines.front() ;
+
+				auto id = line.id() ;
+
+				if( id != -1 ){
+
+					auto it = m_index.find( id ) ;
+
+					if( it != m_index.end() && it->second == m_offset ){
+
+						m_index.erase( it ) ;
+					}
+				}
+
+				m_size -= line.size() ;
+
+				if( m_onEvicted ){
+
+					m_onEvicted( line.text() ) ;
+				}
+
+				m_lines.pop_front() ;
+
+				m_offset++ ;
+
+				this->changed( change::type::removeFirst,0 ) ;
+			}
 		}
-		template< typename It >
-		void add( const It& it,const QString& text,int id )
+		/*
+		 * Lines of an id are always next to each other, they are only
+		 * ever added after the last one of it. The line before the one
+		 * removed at position is the new last line of id or there is none.
+		 */
+		void reIndex( int id,size_t position )
 		{
-			if( it != m_lines.rbegin() ){
+			if( position > 0 && m_lines[ position - 1 ].id() == id ){
 
-				m_lines.emplace( it.base(),text,id ) ;
+				m_index[ id ] = m_offset + position - 1 ;
 			}else{
-				m_lines.emplace_back( text,id ) ;
+				m_index.erase( id ) ;
+			}
+		}
+		void changed( change::type t,size_t index,const QString& text = QString() )
+		{
+			if( !m_trackChanges ){
+
+				return ;
+			}
+
+			if( !m_changes.empty() && m_changes[ 0 ].what() == change::type::clear ){
+
+				return ;
+			}
+
+			if( t == change::type::replace && !m_changes.empty() ){
+
+				auto& e = *m_changes.rbegin() ;
+
+				if( e.what() == change::type::replace && e.index() == index ){
+
+					/*
+					 * Only the last text of a line that keeps being updated
+					 * needs to make it to the screen.
+					 */
+					e.replace( text ) ;
+
+					return ;
+				}
+			}
+
+			if( t == change::type::clear || m_changes.size() > m_lines.size() ){
+
+				/*
+				 * Re rendering everything is cheaper than replaying a
+				 * change list that is longer than the log itself.
+				 */
+				m_changes.clear() ;
+				m_changes.emplace_back( change::type::clear,0,QString() ) ;
+			}else{
+				m_changes.emplace_back( t,index,text ) ;
 			}
 		}
 		class line
@@ -197,6 +457,10 @@ public:
 			{
 				return m_id ;
 			}
+			size_t size() const
+			{
+				return static_cast< size_t >( m_text.size() ) * sizeof( QChar ) ;
+			}
 			void replace( const QString& text )
 			{
 				m_text = text ;
@@ -205,10 +469,173 @@ public:
 			QString m_text ;
 			int m_id ;
 		} ;
-		std::vector< Logger::Data::line > m_lines ;
+		std::deque< Logger::Data::line > m_lines ;
+		std::vector< Logger::Data::change > m_changes ;
+		std::unordered_map< int,size_t > m_index ;
+		size_t m_offset = 0 ;
+		size_t m_size = 0 ;
+		size_t m_maxLines = 0 ;
+		size_t m_maxBytes = 0 ;
+		std::function< void( const QString& ) > m_onEvicted ;
+		bool m_trackChanges ;
+	} ;
+
+	/*
+	 * Lines of a single job, used to parse its output away from the gui
+	 * thread. take() returns what changed since it was last called and
+	 * only keeps the last line around for the parser to update.
+	 */
+	class jobData
+	{
+	public:
+		class update
+		{
+		public:
+			update() = default ;
+			update( QStringList lines,bool replaceLast ) :
+				m_lines( std::move( lines ) ),
+				m_replaceLast( replaceLast )
+			{
+			}
+			bool isEmpty() const
+			{
+				return m_lines.isEmpty() ;
+			}
+			/*
+			 * The lines as the engine printed them.
+			 */
+			const QStringList& lines() const
+			{
+				return m_lines ;
+			}
+			bool replacesLast() const
+			{
+				return m_replaceLast ;
+			}
+			/*
+			 * length lines from position as an update of their own,
+			 * only the first line can replace the last one.
+			 */
+			update mid( int position,int length ) const
+			{
+				update e( m_lines.mid( position,length ),m_replaceLast && position == 0 ) ;
+
+				if( !m_logLines.isEmpty() ){
+
+					e.m_logLines = m_logLines.mid( position,length ) ;
+				}
+
+				return e ;
+			}
+			/*
+			 * Function takes a line by reference and returns true if it
+			 * removed from it text that is only meant for the engine's
+			 * parser, the log then gets the changed lines.
+			 */
+			template< typename Function >
+			void setLogLines( Function function )
+			{
+				for( int i = 0 ; i < m_lines.size() ; i++ ){
+
+					auto e = m_lines[ i ] ;
+
+					if( function( e ) ){
+
+						if( m_logLines.isEmpty() ){
+
+							m_logLines = m_lines ;
+						}
+
+						m_logLines[ i ] = std::move( e ) ;
+					}
+				}
+			}
+			/*
+			 * Adds the lines as they are to be logged.
+			 */
+			void operator()( Logger::Data& e,int id ) const
+			{
+				this->apply( m_logLines.isEmpty() ? m_lines : m_logLines,e,id ) ;
+			}
+			/*
+			 * Adds the lines as the engine printed them, for stores
+			 * that are parsed rather than shown.
+			 */
+			void applyAsPrinted( Logger::Data& e,int id ) const
+			{
+				this->apply( m_lines,e,id ) ;
+			}
+		private:
+			void apply( const QStringList& lines,Logger::Data& e,int id ) const
+			{
+				for( int i = 0 ; i < lines.size() ; i++ ){
+
+					if( i == 0 && m_replaceLast ){
+
+						e.replaceLast( lines[ i ],id ) ;
+					}else{
+						e.add( lines[ i ],id ) ;
+					}
+				}
+			}
+			QStringList m_lines ;
+			QStringList m_logLines ;
+			bool m_replaceLast = false ;
+		} ;
+		/*
+		 * The store only ever holds lines of this job, any id other
+		 * than -1 keeps them grouped the way the main log does.
+		 */
+		static constexpr int id = 0 ;
+
+		Logger::Data& lines()
+		{
+			return m_lines ;
+		}
+		update take()
+		{
+			if( m_lines.isEmpty() ){
+
+				return {} ;
+			}
+
+			QStringList m ;
+
+			size_t s = 0 ;
+
+			bool replaceLast = false ;
+
+			if( m_hasLast ){
+
+				if( m_lines[ 0 ] != m_last ){
+
+					m.append( m_lines[ 0 ] ) ;
+					replaceLast = true ;
+				}
+
+				s = 1 ;
+			}
+
+			for( ; s < m_lines.size() ; s++ ){
+
+				m.append( m_lines[ s ] ) ;
+			}
+
+			m_last = m_lines.lastText() ;
+			m_hasLast = true ;
+
+			m_lines.clear() ;
+			m_lines.add( m_last,jobData::id ) ;
+
+			return { std::move( m ),replaceLast } ;
+		}
+	private:
+		Logger::Data m_lines ;
+		QString m_last ;
+		bool m_hasLast = false ;
 	} ;
 
-	Logger( QPlainTextEdit& ) ;
+	Logger( QPlainTextEdit&,settings& ) ;
 	void add( const QString&,int id = -1 ) ;
 	void clear() ;
 	template< typename Function >
@@ -217,14 +644,58 @@ public:
 		function( m_lines,id ) ;
 		this->update() ;
 	}
+	/*
+	 * Function will be called on the next screen update, a newer
+	 * function with the same id replaces the one still waiting.
+	 */
+	template< typename Function >
+	void updateLater( int id,Function function )
+	{
+		m_updates[ id ] = std::move( function ) ;
+		this->update() ;
+	}
+	void flush() ;
 	Logger( const Logger& ) = delete ;
 	Logger& operator=( const Logger& ) = delete ;
 	Logger( Logger&& ) = delete ;
 	Logger& operator=( Logger&& ) = delete ;
 private:
+	/*
+	 * Evicted lines in a file of at most maximum bytes, lines are read
+	 * back a page at a time going backwards from the newest.
+	 */
+	class history
+	{
+	public:
+		history( const QString& path,qint64 maximum ) ;
+		void add( const QString& ) ;
+		void clear() ;
+		void rewind() ;
+		QStringList previous( int count ) ;
+		/*
+		 * Moves past the oldest count lines returned by previous(),
+		 * they are returned again by the next call to it.
+		 */
+		void skip( int count ) ;
+	private:
+		void compact() ;
+		QFile m_file ;
+		qint64 m_maximum ;
+		qint64 m_position = -1 ;
+		int m_dropped = 0 ;
+	} ;
 	void update() ;
+	void updateView() ;
+	void render( QTextCursor&,const Logger::Data::change& ) ;
+	void pageIn() ;
+	void pageOut() ;
 	QPlainTextEdit& m_textEdit ;
 	Logger::Data m_lines ;
+	QTimer m_timer ;
+	std::map< int,std::function< void() > > m_updates ;
+	std::unique_ptr< Logger::history > m_history ;
+	int m_historyLines = 0 ;
+	bool m_paging = false ;
 } ;
 
 class LoggerWrapper
@@ -244,6 +715,10 @@ public:
 	{
 		m_logger->clear() ;
 	}
+	void flush()
+	{
+		m_logger->flush() ;
+	}
 	template< typename Function >
 	void add( const Function& function )
 	{
@@ -255,7 +730,8 @@ private:
 };
 
 template< typename Function,
-	  typename Engine >
+	  typename Engine,
+	  typename Progress >
 class loggerBatchDownloader
 {
 public:
@@ -263,13 +739,20 @@ public:
 			       Engine& engine,
 			       Logger& logger,
 			       QTableWidgetItem& item,
-			       int id ) :
+			       int id,
+			       Progress progress ) :
 		m_tableWidgetItem( item ),
-		m_function( std::move( function ) ),
+		m_function( std::make_shared< Function >( std::move( function ) ) ),
+		m_progress( std::move( progress ) ),
 		m_engine( engine ),
 		m_logger( logger ),
 		m_id( id )
 	{
+		/*
+		 * Only the last few lines are ever looked at, the full output
+		 * is already kept by the main logger.
+		 */
+		m_lines.setLimits( 16,0 ) ;
 	}
 	void add( const QString& s )
 	{
@@ -286,9 +769,14 @@ public:
 	}
 	void clear()
 	{
+		m_logger.flush() ;
 		m_tableWidgetItem.setText( "" ) ;
 		m_lines.clear() ;
 	}
+	void flush()
+	{
+		m_logger.flush() ;
+	}
 	template< typename F >
 	void add( const F& function )
 	{
@@ -296,31 +784,54 @@ public:
 		function( m_lines,-1 ) ;
 		this->update() ;
 	}
+	/*
+	 * The filter needs the lines as printed, the log gets them without
+	 * what only the parser uses.
+	 */
+	void add( const Logger::jobData::update& e )
+	{
+		m_logger.add( e,m_id ) ;
+		e.applyAsPrinted( m_lines,-1 ) ;
+		this->update() ;
+	}
 private:
 	void update()
 	{
 		if( m_lines.isNotEmpty() ){
 
-			auto& function = *m_function ;
-			m_tableWidgetItem.setText( function( m_engine,m_lines.lastText() ) ) ;
+			/*
+			 * This object may be moved before the update runs, take
+			 * what is needed by value.
+			 */
+			auto item = &m_tableWidgetItem ;
+			auto engine = &m_engine ;
+
+			m_logger.updateLater( m_id,[ item,engine,function = m_function,progress = m_progress,text = m_lines.lastText() ](){
+
+				auto& filter = **function ;
+				item->setText( filter( *engine,text ) ) ;
+				progress( filter.lastEvent() ) ;
+			} ) ;
 		}
 	}
 	QTableWidgetItem& m_tableWidgetItem ;
-	Function m_function ;
+	std::shared_ptr< Function > m_function ;
+	Progress m_progress ;
 	Engine& m_engine ;
 	Logger& m_logger ;
 	Logger::Data m_lines ;
 	int m_id ;
 } ;
 
-template< typename Function,typename Engine >
+template< typename Function,typename Engine,typename Progress >
 static auto make_loggerBatchDownloader( Function function,
 					Engine& engine,
 					Logger& logger,
 					QTableWidgetItem& item,
-					int id )
+					int id,
+					Progress progress )
 {
-	return loggerBatchDownloader< Function,Engine >( std::move( function ),engine,logger,item,id ) ;
+	return loggerBatchDownloader< Function,Engine,Progress >( std::move( function ),engine,logger,item,id,std::move( progress ) ) ;
 }
 
 template< typename AddToTable >
@@ -357,6 +868,10 @@ public:
 
 		m_lines.clear() ;
 	}
+	void flush()
+	{
+		m_logger.flush() ;
+	}
 	template< typename Function >
 	void add( const Function& function )
 	{
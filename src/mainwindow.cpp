@@ -37,7 +37,7 @@ MainWindow::MainWindow( QApplication& app,settings& s,translator& t ) :
 	m_qApp( app ),
 	m_ui( _init_ui( *this ) ),
 	m_showTrayIcon( s.showTrayIcon() ),
-	m_logger( *m_ui->plainTextEditLogger ),
+	m_logger( *m_ui->plainTextEditLogger,s ),
 	m_engines( m_logger,s ),
 	m_tabManager( s,t,m_engines,m_logger,*m_ui,*this,*this ),
 	m_settings( s )
@@ -0,0 +1,422 @@
+/*
+ *
+ *  Copyright (c) 2021
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "metadatacache.h"
+
+#include "settings.h"
+#include "logger.h"
+#include "utility.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QCryptographicHash>
+#include <QUrl>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+
+static const char * _kindName( metadataCache::kind k )
+{
+	switch( k ) {
+		case metadataCache::kind::title    : return "title" ;
+		case metadataCache::kind::formats  : return "formats" ;
+		case metadataCache::kind::playlist : return "playlist" ;
+	}
+
+	return "" ;
+}
+
+static QByteArray _line( const QString& key,qint64 time,const QString& value )
+{
+	QJsonObject obj ;
+
+	obj.insert( "key",key ) ;
+	obj.insert( "time",time ) ;
+	obj.insert( "value",value ) ;
+
+	return QJsonDocument( obj ).toJson( QJsonDocument::Compact ) + "\n" ;
+}
+
+static qint64 _now()
+{
+	return QDateTime::currentMSecsSinceEpoch() / 1000 ;
+}
+
+metadataCache::metadataCache( settings& s,engines& e,Logger& l ) :
+	m_settings( s ),
+	m_engines( e ),
+	m_logger( l ),
+	m_path( engines::enginePaths( s ).basePath() + "/metadata.cache" ),
+	m_infoJsonPath( engines::enginePaths( s ).basePath() + "/infojson" )
+{
+	this->load() ;
+	this->removeStaleInfoJson() ;
+}
+
+void metadataCache::setEngineVersion( const QString& engine,const QString& version )
+{
+	m_versions[ engine ] = version ;
+}
+
+QString metadataCache::get( kind k,const engines::engine& engine,const QString& url,const QString& variant )
+{
+	auto it = m_entries.find( this->key( _kindName( k ),engine,url,variant ) ) ;
+
+	if( it == m_entries.end() ){
+
+		return QString() ;
+
+	}else if( this->expired( it->second,_now() ) ){
+
+		m_entries.erase( it ) ;
+
+		return QString() ;
+	}else{
+		return it->second.value ;
+	}
+}
+
+void metadataCache::set( kind k,const engines::engine& engine,const QString& url,const QString& value,const QString& variant )
+{
+	if( m_settings.metadataCacheTimeToLive() <= 0 || value.isEmpty() ){
+
+		return ;
+	}
+
+	auto key = this->key( _kindName( k ),engine,url,variant ) ;
+
+	auto now = _now() ;
+
+	m_entries[ key ] = { now,value } ;
+
+	QFile file( m_path ) ;
+
+	if( file.open( QIODevice::WriteOnly | QIODevice::Append ) ){
+
+		file.write( _line( key,now,value ) ) ;
+	}
+}
+
+QString metadataCache::infoJson( const engines::engine& engine,const QString& url,const QString& options )
+{
+	QFileInfo info( this->infoJsonPath( engine,url,options ) ) ;
+
+	if( info.exists() ){
+
+		auto age = info.lastModified().secsTo( QDateTime::currentDateTime() ) ;
+
+		if( age < this->infoJsonTimeToLive() ){
+
+			return info.filePath() ;
+		}
+
+		QFile::remove( info.filePath() ) ;
+	}
+
+	return QString() ;
+}
+
+void metadataCache::setInfoJson( const engines::engine& engine,const QString& url,const QString& options,const QByteArray& json )
+{
+	if( this->infoJsonTimeToLive() <= 0 || json.isEmpty() ){
+
+		return ;
+	}
+
+	QDir().mkpath( m_infoJsonPath ) ;
+
+	QFile file( this->infoJsonPath( engine,url,options ) ) ;
+
+	if( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ){
+
+		file.write( json ) ;
+	}
+}
+
+struct urlInfo
+{
+	QString title ;
+	QByteArray json ;
+	int entries = 0 ;
+} ;
+
+/*
+ * Returns what was found by the url it was asked for. A url with more than
+ * one entry is a playlist and keeps the title of its first entry.
+ */
+static std::map< QString,urlInfo > _urlInfo( const QByteArray& output,const QString& urlField,const QString& url )
+{
+	std::map< QString,urlInfo > m ;
+
+	for( const auto& it : output.split( '\n' ) ){
+
+		auto obj = QJsonDocument::fromJson( it ).object() ;
+
+		if( obj.isEmpty() ){
+
+			continue ;
+		}
+
+		auto& e = m[ urlField.isEmpty() ? url : obj.value( urlField ).toString() ] ;
+
+		if( e.entries == 0 ){
+
+			e.title = obj.value( "title" ).toString() ;
+			e.json = it ;
+		}
+
+		e.entries++ ;
+	}
+
+	return m ;
+}
+
+void metadataCache::resolve( const engines::engine& engine,
+			     const QStringList& urls,
+			     const QString& options,
+			     std::function< void( const metadataCache::titles& ) > done )
+{
+	/*
+	 * The urls are extracted the way their download would extract them,
+	 * cookies, proxies and extractor arguments change what a site returns.
+	 */
+	utility::args opts( options ) ;
+
+	QStringList args{ "--ignore-errors","--no-warnings","--dump-json" } ;
+
+	args.append( utility::updateOptions( engine,opts,urls ) ) ;
+
+	engines::engine::exeArgs::cmd cmd( engine.exePath(),args ) ;
+
+	m_logger.add( "cmd: " + engine.commandString( cmd ) ) ;
+
+	/*
+	 * Output is used even when the process fails, with --ignore-errors a
+	 * failed url only means its json is missing.
+	 */
+	utility::run( cmd.exe(),cmd.args(),[ this ]( QProcess& exe ){
+
+		exe.setProcessEnvironment( m_engines.processEnvironment() ) ;
+
+		exe.setProcessChannelMode( QProcess::ProcessChannelMode::SeparateChannels ) ;
+
+		return QByteArray() ;
+
+	},[ &engine,quality = opts.quality ]( QProcess& exe ){
+
+		engine.sendCredentials( quality,exe ) ;
+
+	},[ this,&engine,urls,options,done = std::move( done ) ]( int,QProcess::ExitStatus,QByteArray& c ){
+
+		auto info = std::make_shared< std::map< QString,urlInfo > >() ;
+
+		auto work = [ info,output = std::move( c ),urlField = engine.infoJsonUrlField(),url = urls.value( 0 ) ](){
+
+			*info = _urlInfo( output,urlField,url ) ;
+		} ;
+
+		utility::runInBackground( std::move( work ),[ this,&engine,info,urls,options,done ](){
+
+			metadataCache::titles titles ;
+
+			for( const auto& it : urls ){
+
+				auto m = info->find( it ) ;
+
+				if( m == info->end() ){
+
+					continue ;
+				}
+
+				const auto& e = m->second ;
+
+				/*
+				 * Kept so the download can start from it instead of
+				 * extracting the url again.
+				 */
+				if( e.entries == 1 ){
+
+					this->setInfoJson( engine,it,options,e.json ) ;
+				}
+
+				if( !e.title.isEmpty() ){
+
+					this->set( metadataCache::kind::title,engine,it,e.title ) ;
+
+					titles.emplace( it,e.title ) ;
+				}
+			}
+
+			done( titles ) ;
+		} ) ;
+
+	},[]( QProcess::ProcessChannel channel,QByteArray data,QByteArray& c ){
+
+		if( channel == QProcess::ProcessChannel::StandardOutput ){
+
+			c += data ;
+		}
+	} ) ;
+}
+
+void metadataCache::clear()
+{
+	m_entries.clear() ;
+
+	QFile::remove( m_path ) ;
+
+	QDir( m_infoJsonPath ).removeRecursively() ;
+}
+
+QString metadataCache::normalizeUrl( const QString& e )
+{
+	QUrl url( e.trimmed() ) ;
+
+	if( !url.isValid() || url.host().isEmpty() ){
+
+		return e.trimmed() ;
+	}
+
+	url.setHost( url.host().toLower() ) ;
+	url.setFragment( QString() ) ;
+
+	return url.toString( QUrl::NormalizePathSegments | QUrl::StripTrailingSlash ) ;
+}
+
+QString metadataCache::key( const char * kind,const engines::engine& engine,const QString& url,const QString& variant ) const
+{
+	QString version ;
+
+	auto it = m_versions.find( engine.name() ) ;
+
+	if( it != m_versions.end() ){
+
+		version = it->second ;
+	}
+
+	auto m = engine.name() + " " + version + " " + kind + " " + metadataCache::normalizeUrl( url ) ;
+
+	if( variant.isEmpty() ){
+
+		return m ;
+	}else{
+		return m + " " + variant ;
+	}
+}
+
+QString metadataCache::infoJsonPath( const engines::engine& engine,const QString& url,const QString& options ) const
+{
+	auto key = this->key( "infojson",engine,url,options.simplified() ) ;
+
+	auto hash = QCryptographicHash::hash( key.toUtf8(),QCryptographicHash::Sha1 ).toHex() ;
+
+	return m_infoJsonPath + "/" + hash + ".json" ;
+}
+
+/*
+ * Signed media urls of the sites that sign them last a few hours at least,
+ * an hour leaves room for the download to start.
+ */
+qint64 metadataCache::infoJsonTimeToLive()
+{
+	return std::min( static_cast< qint64 >( m_settings.metadataCacheTimeToLive() ),static_cast< qint64 >( 60 * 60 ) ) ;
+}
+
+bool metadataCache::expired( const entry& e,qint64 now )
+{
+	auto ttl = m_settings.metadataCacheTimeToLive() ;
+
+	return ttl <= 0 || now - e.time > ttl ;
+}
+
+void metadataCache::load()
+{
+	QFile file( m_path ) ;
+
+	if( !file.open( QIODevice::ReadOnly ) ){
+
+		return ;
+	}
+
+	auto now = _now() ;
+
+	int lines = 0 ;
+
+	for( const auto& it : file.readAll().split( '\n' ) ){
+
+		auto obj = QJsonDocument::fromJson( it ).object() ;
+
+		if( obj.isEmpty() ){
+
+			continue ;
+		}
+
+		lines++ ;
+
+		entry e{ static_cast< qint64 >( obj.value( "time" ).toDouble() ),obj.value( "value" ).toString() } ;
+
+		auto key = obj.value( "key" ).toString() ;
+
+		if( this->expired( e,now ) ){
+
+			m_entries.erase( key ) ;
+		}else{
+			m_entries[ key ] = std::move( e ) ;
+		}
+	}
+
+	file.close() ;
+
+	/*
+	 * Later lines replace earlier ones, rewrite the file once it holds
+	 * more stale lines than live ones.
+	 */
+	if( lines > 2 * static_cast< int >( m_entries.size() ) ){
+
+		if( m_entries.empty() ){
+
+			QFile::remove( m_path ) ;
+
+		}else if( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ){
+
+			for( const auto& it : m_entries ){
+
+				file.write( _line( it.first,it.second.time,it.second.value ) ) ;
+			}
+		}
+	}
+}
+
+void metadataCache::removeStaleInfoJson()
+{
+	auto now = QDateTime::currentDateTime() ;
+
+	auto ttl = this->infoJsonTimeToLive() ;
+
+	for( const auto& it : QDir( m_infoJsonPath ).entryInfoList( QDir::Files ) ){
+
+		if( it.lastModified().secsTo( now ) >= ttl ){
+
+			QFile::remove( it.filePath() ) ;
+		}
+	}
+}
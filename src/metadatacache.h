@@ -0,0 +1,111 @@
+/*
+ *
+ *  Copyright (c) 2021
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METADATA_CACHE_H
+#define METADATA_CACHE_H
+
+#include <QString>
+#include <QStringList>
+
+#include <map>
+#include <functional>
+
+#include "engines.h"
+
+class settings ;
+class Logger ;
+
+/*
+ * What the engines said about a url before, kept on disk so the same title,
+ * format list or playlist listing is not extracted again on every query.
+ *
+ * Entries are keyed by the normalized url together with the name and the
+ * version of the engine that produced them and expire after the time set in
+ * settings::metadataCacheTimeToLive(). Everything is held in memory so look
+ * ups are cheap enough for the gui thread, the file is only appended to and
+ * is compacted when loaded.
+ */
+class metadataCache
+{
+public:
+	enum class kind{ title,formats,playlist } ;
+
+	using titles = std::map< QString,QString > ;
+
+	metadataCache( settings&,engines&,Logger& ) ;
+	/*
+	 * Versions are learned when the engines are checked at start up.
+	 */
+	void setEngineVersion( const QString& engine,const QString& version ) ;
+	/*
+	 * variant separates entries of the same url that depend on something
+	 * else, like the range of a playlist listing. Returns an empty string
+	 * if there is no entry that is still fresh.
+	 */
+	QString get( kind,const engines::engine&,const QString& url,const QString& variant = QString() ) ;
+	void set( kind,const engines::engine&,const QString& url,const QString& value,const QString& variant = QString() ) ;
+	/*
+	 * Info json is kept in a file of its own so the engine can load it
+	 * at download time. The media urls in it are signed and expire, the
+	 * path is only returned while the file is young, empty otherwise.
+	 *
+	 * options are the user's download options, info json extracted with
+	 * other cookies, credentials or extractor arguments is not used.
+	 */
+	QString infoJson( const engines::engine&,const QString& url,const QString& options ) ;
+	void setInfoJson( const engines::engine&,const QString& url,const QString& options,const QByteArray& ) ;
+	/*
+	 * Runs the engine with --dump-json on the urls, with the same options
+	 * and credentials a download with options would use, and keeps the
+	 * titles and the info json it prints. done is called on the gui thread
+	 * with the titles by url, urls that failed are missing. An engine
+	 * without infoJsonUrlField() can not say which url an entry came from
+	 * and must be given one url at a time.
+	 */
+	void resolve( const engines::engine&,
+		      const QStringList& urls,
+		      const QString& options,
+		      std::function< void( const metadataCache::titles& ) > done ) ;
+	/*
+	 * Forgets everything, in memory and on disk.
+	 */
+	void clear() ;
+	static QString normalizeUrl( const QString& ) ;
+private:
+	struct entry
+	{
+		qint64 time ;
+		QString value ;
+	} ;
+	QString key( const char * kind,const engines::engine&,const QString& url,const QString& variant ) const ;
+	QString infoJsonPath( const engines::engine&,const QString& url,const QString& options ) const ;
+	qint64 infoJsonTimeToLive() ;
+	bool expired( const entry&,qint64 now ) ;
+	void load() ;
+	void removeStaleInfoJson() ;
+	settings& m_settings ;
+	engines& m_engines ;
+	Logger& m_logger ;
+	QString m_path ;
+	QString m_infoJsonPath ;
+	std::map< QString,QString > m_versions ;
+	std::map< QString,entry > m_entries ;
+} ;
+
+#endif
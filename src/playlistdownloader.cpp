@@ -32,7 +32,8 @@ playlistdownloader::playlistdownloader( Context& ctx ) :
 	m_ccmd( m_ctx,
 		playlistdownloader::Index( m_playlistEntry,*m_ui.tableWidgetPl ),
 		*m_ui.lineEditPLUrlOptions,
-		*m_ui.pbPLCancel )
+		*m_ui.pbPLCancel,
+		scheduler::queue::playlist )
 {
 	this->resetMenu() ;
 
@@ -124,6 +125,10 @@ void playlistdownloader::resetMenu()
 		}else if( ac.openFolderPath() ){
 
 			utility::openDownloadFolderPath( m_settings.downloadFolder() ) ;
+
+		}else if( ac.clearMetadataCache() ){
+
+			m_ctx.MetadataCache().clear() ;
 		}else{
 			m_ui.lineEditPLUrlOptions->setText( ac.objectName() ) ;
 
@@ -233,18 +238,41 @@ void playlistdownloader::download( const engines::engine& engine )
 		}
 	}
 
-	m_ccmd.download( engine,[ this ](){
+	m_ccmd.download( engine,[ this ]( const engines::engine& engine,const std::vector< int >& indexes ){
 
-		if( m_settings.concurrentDownloading() ){
+		this->download( engine,indexes ) ;
+	} ) ;
+}
 
-			return m_settings.maxConcurrentDownloads() ;
-		}else{
-			return 1 ;
-		}
+void playlistdownloader::download( const engines::engine& engine,const std::vector< int >& indexes )
+{
+	if( indexes.size() == 1 ){
 
-	}(),[ this ]( const engines::engine& engine,int index ){
+		return this->download( engine,indexes[ 0 ] ) ;
+	}
 
-		this->download( engine,index ) ;
+	auto group = m_ccmd.makeGroup( engine,indexes ) ;
+
+	auto aa = playlistdownloader::make_options( *m_ui.pbPLCancel,m_ctx,m_ctx.debug(),[ &engine,group,this ]( bool e ){
+
+		m_ccmd.monitorForFinished( *group,e,[ &engine,this ]( const concurrentDownloadManagerFinishedStatus& f ){
+
+			m_running = !f.allFinished ;
+
+			utility::updateFinishedState( engine,m_settings,*m_ui.tableWidgetPl,f ) ;
+		} ) ;
+	} ) ;
+
+	m_ccmd.download( engine,group,std::move( aa ),[ &engine,this ]( int index ){
+
+		auto id = utility::concurrentID() ;
+
+		return make_loggerBatchDownloader( engine.filter(),
+						   engine,
+						   m_ctx.logger(),
+						   *m_ui.tableWidgetPl->item( index,0 ),
+						   id,
+						   m_ctx.Scheduler().reporterFor( id ) ) ;
 	} ) ;
 }
 
@@ -252,11 +280,7 @@ void playlistdownloader::download( const engines::engine& engine,int index )
 {
 	auto aa = playlistdownloader::make_options( *m_ui.pbPLCancel,m_ctx,m_ctx.debug(),[ &engine,index,this ]( bool e ){
 
-		m_ccmd.monitorForFinished( engine,index,e,[ this ]( const engines::engine& engine,int index ){
-
-			this->download( engine,index ) ;
-
-		},[ &engine,this ]( const concurrentDownloadManagerFinishedStatus& f ){
+		m_ccmd.monitorForFinished( index,e,[ &engine,this ]( const concurrentDownloadManagerFinishedStatus& f ){
 
 			m_running = !f.allFinished ;
 
@@ -264,6 +288,8 @@ void playlistdownloader::download( const engines::engine& engine,int index )
 		} ) ;
 	} ) ;
 
+	auto id = utility::concurrentID() ;
+
 	m_ccmd.download( engine,
 			 index,
 			 m_ui.tableWidgetPl->item( index,1 )->text(),
@@ -272,7 +298,8 @@ void playlistdownloader::download( const engines::engine& engine,int index )
 						     engine,
 						     m_ctx.logger(),
 						     *m_ui.tableWidgetPl->item( index,0 ),
-						     utility::concurrentID() ) ) ;
+						     id,
+						     m_ctx.Scheduler().reporterFor( id ) ) ) ;
 }
 
 void playlistdownloader::getList()
@@ -284,18 +311,45 @@ void playlistdownloader::getList()
 		return ;
 	}
 
-	m_ctx.TabManager().disableAll() ;
+	const auto& engine = m_ctx.Engines().defaultEngine() ;
 
-	m_ui.pbPLCancel->setEnabled( true ) ;
+	auto range = m_ui.lineEditPLDownloadRange->text() ;
 
-	const auto& engine = m_ctx.Engines().defaultEngine() ;
+	auto bb = []( QTableWidget& table,const QString& txt,const QFont& font ){
+
+		auto s = concurrentDownloadManagerFinishedStatus::notStarted() ;
+		utility::addItem( table,{ txt,txt,s },font,Qt::AlignCenter ) ;
+	} ;
+
+	/*
+	 * Entries are kept as a url line followed by a title line.
+	 */
+	auto cached = m_ctx.MetadataCache().get( metadataCache::kind::playlist,engine,url,range ) ;
+
+	if( !cached.isEmpty() ){
+
+		m_ui.lineEditPLDownloadRange->clear() ;
+
+		utility::clear( *m_ui.tableWidgetPl ) ;
+
+		auto m = cached.split( '\n' ) ;
+
+		for( int i = 0 ; i + 1 < m.size() ; i += 2 ){
+
+			bb( *m_ui.tableWidgetPl,m.at( i ) + "\n" + m.at( i + 1 ),m_ctx.mainWidget().font() ) ;
+		}
+
+		return ;
+	}
+
+	m_ctx.TabManager().setDownloading( tabManager::tab::playlist,true ) ;
+
+	m_ui.pbPLCancel->setEnabled( true ) ;
 
 	QStringList opts ;
 
 	opts.append( engine.playListIdArguments() ) ;
 
-	auto range = m_ui.lineEditPLDownloadRange->text() ;
-
 	m_ui.lineEditPLDownloadRange->clear() ;
 
 	if( !range.isEmpty() ){
@@ -308,19 +362,27 @@ void playlistdownloader::getList()
 
 	utility::args args( m_ui.lineEditPLUrlOptions->text() ) ;
 
-	auto aa = playlistdownloader::make_options( *m_ui.pbPLCancel,m_ctx,m_ctx.debug(),[ this ]( bool ){
+	auto entries = std::make_shared< QStringList >() ;
+
+	auto aa = playlistdownloader::make_options( *m_ui.pbPLCancel,m_ctx,m_ctx.debug(),[ this,&engine,url,range,entries ]( bool e ){
+
+		if( e ){
+
+			m_ctx.MetadataCache().set( metadataCache::kind::playlist,engine,url,entries->join( '\n' ),range ) ;
+		}
 
 		m_running = false ;
-		m_ctx.TabManager().enableAll() ;
+		m_ctx.TabManager().setDownloading( tabManager::tab::playlist,false ) ;
 		m_ui.pbPLCancel->setEnabled( false ) ;
 	} ) ;
 
 	m_running = true ;
 
-	auto bb = []( QTableWidget& table,const QString& txt,const QFont& font ){
+	auto cc = [ bb,entries ]( QTableWidget& table,const QString& txt,const QFont& font ){
 
-		auto s = concurrentDownloadManagerFinishedStatus::notStarted() ;
-		utility::addItem( table,{ txt,txt,s },font,Qt::AlignCenter ) ;
+		entries->append( txt ) ;
+
+		bb( table,txt,font ) ;
 	} ;
 
 	utility::run( engine,
@@ -332,7 +394,7 @@ void playlistdownloader::getList()
 						     m_ctx.logger(),
 						     engine.playListUrlPrefix(),
 						     utility::concurrentID(),
-						     std::move( bb ) ),
+						     std::move( cc ) ),
 		      utility::make_term_conn( m_ui.pbPLCancel,&QPushButton::clicked ),
 		      QProcess::ProcessChannel::StandardOutput ) ;
 }
@@ -348,10 +410,5 @@ void playlistdownloader::clearScreen()
 
 void playlistdownloader::EnableAll::operator()( bool e )
 {
-	if( e ){
-
-		m_tabManager.enableAll() ;
-	}else{
-		m_tabManager.disableAll() ;
-	}
+	m_tabManager.setDownloading( tabManager::tab::playlist,!e ) ;
 }
@@ -43,6 +43,7 @@ private:
 	void download() ;
 	void download( const engines::engine& ) ;
 	void download( const engines::engine&,int ) ;
+	void download( const engines::engine&,const std::vector< int >& ) ;
 	void getList() ;
 	void clearScreen() ;
 
@@ -133,6 +134,10 @@ private:
 		{
 			return false ;
 		}
+		/*
+		 * Process output is never asked for, do not keep any of it.
+		 */
+		static constexpr int maxCapturedOutputSize = 0 ;
 		options& enableCancel( bool e )
 		{
 			Q_UNUSED( e )
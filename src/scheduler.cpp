@@ -0,0 +1,576 @@
+/*
+ *
+ *  Copyright (c) 2021
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scheduler.h"
+
+#include "settings.h"
+#include "utility.h"
+
+#include <QFile>
+
+#include <vector>
+
+static void _decrement( std::map< QString,int >& m,const QString& key )
+{
+	auto it = m.find( key ) ;
+
+	if( it != m.end() ){
+
+		if( it->second > 1 ){
+
+			it->second-- ;
+		}else{
+			m.erase( it ) ;
+		}
+	}
+}
+
+static int _count( const std::map< QString,int >& m,const QString& key )
+{
+	auto it = m.find( key ) ;
+
+	if( it != m.end() ){
+
+		return it->second ;
+	}else{
+		return 0 ;
+	}
+}
+
+scheduler::key::key( const engines::engine& engine,const QString& url ) :
+	host( engine.concurrencyKey( url ) ),
+	engine( engine.name() ),
+	engineMaximum( engine.maxConcurrentDownloads() )
+{
+}
+
+/*
+ * Reads the first line of /proc/stat, other platforms get zeros and the
+ * automatic limit only goes by download speed there.
+ */
+static void _cpuTimes( qint64& total,qint64& idle,qint64& ioWait )
+{
+	total = 0 ;
+	idle = 0 ;
+	ioWait = 0 ;
+
+	if( !utility::platformIsLinux() ){
+
+		return ;
+	}
+
+	QFile file( "/proc/stat" ) ;
+
+	if( !file.open( QIODevice::ReadOnly ) ){
+
+		return ;
+	}
+
+	auto m = utility::split( QString( file.readLine() ),' ',true ) ;
+
+	for( int i = 1 ; i < m.size() ; i++ ){
+
+		auto s = m[ i ].toLongLong() ;
+
+		total += s ;
+
+		if( i == 4 ){
+
+			idle = s ;
+
+		}else if( i == 5 ){
+
+			ioWait = s ;
+		}
+	}
+}
+
+scheduler::scheduler( settings& s ) : m_settings( s )
+{
+	m_clock.start() ;
+
+	QObject::connect( &m_timer,&QTimer::timeout,[ this ](){
+
+		this->prefetchTimeouts() ;
+		this->adjust() ;
+	} ) ;
+
+	m_timer.start( 5000 ) ;
+}
+
+scheduler::priority scheduler::priorityOf( scheduler::queue q )
+{
+	if( q == scheduler::queue::basic ){
+
+		return scheduler::priority::interactive ;
+	}else{
+		return scheduler::priority::background ;
+	}
+}
+
+void scheduler::submit( scheduler::queue q,
+			scheduler::key key,
+			std::function< void() > job,
+			scheduler::prefetcher prefetch )
+{
+	scheduler::job m ;
+
+	m.id = m_ids++ ;
+	m.key = std::move( key ) ;
+	m.function = std::move( job ) ;
+	m.prefetch = std::move( prefetch ) ;
+
+	this->jobsOf( q ).queued.emplace_back( std::move( m ) ) ;
+
+	this->schedule() ;
+}
+
+void scheduler::finished( scheduler::queue q,const scheduler::key& key )
+{
+	auto& m = this->jobsOf( q ) ;
+
+	if( m.running > 0 ){
+
+		m.running-- ;
+		m_running-- ;
+
+		_decrement( m_hosts,key.host ) ;
+		_decrement( m_engines,key.engine ) ;
+	}
+
+	this->schedule() ;
+}
+
+bool scheduler::cancel( scheduler::queue q )
+{
+	auto& m = this->jobsOf( q ).queued ;
+
+	auto s = !m.empty() ;
+
+	m.clear() ;
+
+	return s ;
+}
+
+void scheduler::limitsChanged()
+{
+	this->schedule() ;
+}
+
+void scheduler::progress( int id,const engines::engine::functions::event& e )
+{
+	if( e.what() == engines::engine::functions::event::type::progress && e.speed() >= 0 ){
+
+		m_speeds[ id ] = { e.speed(),m_clock.elapsed() } ;
+	}
+}
+
+scheduler::jobs& scheduler::jobsOf( scheduler::queue q )
+{
+	return m_queues[ static_cast< size_t >( q ) ] ;
+}
+
+int scheduler::maximum()
+{
+	if( m_settings.concurrentDownloading() ){
+
+		auto m = m_settings.maxConcurrentDownloads() ;
+
+		m = m > 0 ? m : 1 ;
+
+		if( m_limit > 0 && m_limit < m ){
+
+			return m_limit ;
+		}else{
+			return m ;
+		}
+	}else{
+		return 1 ;
+	}
+}
+
+qint64 scheduler::throughput()
+{
+	/*
+	 * A job that has not reported for a while is either done or not
+	 * moving any bytes.
+	 */
+	auto now = m_clock.elapsed() ;
+
+	qint64 total = 0 ;
+
+	for( auto it = m_speeds.begin() ; it != m_speeds.end() ; ){
+
+		if( now - it->second.time > 10000 ){
+
+			it = m_speeds.erase( it ) ;
+		}else{
+			total += it->second.bytesPerSecond ;
+			it++ ;
+		}
+	}
+
+	return total ;
+}
+
+void scheduler::adjust()
+{
+	auto throughput = this->throughput() ;
+
+	if( !m_settings.concurrentDownloading() || !m_settings.autoConcurrentDownloads() ){
+
+		m_limit = 0 ;
+		m_throughput = 0 ;
+
+		return ;
+	}
+
+	auto maximum = m_settings.maxConcurrentDownloads() ;
+
+	if( maximum < 1 ){
+
+		maximum = 1 ;
+	}
+
+	scheduler::cpuTimes cpu ;
+
+	_cpuTimes( cpu.total,cpu.idle,cpu.ioWait ) ;
+
+	/*
+	 * Auto mode was just turned on, the first sample is only a baseline.
+	 */
+	if( m_limit == 0 ){
+
+		m_cpuTimes = cpu ;
+		m_limit = ( maximum + 1 ) / 2 ;
+		m_throughput = throughput ;
+
+		return ;
+	}
+
+	auto total = cpu.total - m_cpuTimes.total ;
+	auto idle = cpu.idle - m_cpuTimes.idle ;
+	auto ioWait = cpu.ioWait - m_cpuTimes.ioWait ;
+
+	m_cpuTimes = cpu ;
+
+	auto busy = total > 0 && ( ioWait * 4 > total || idle * 20 < total ) ;
+
+	/*
+	 * Speed only says something about the limit when the limit is what
+	 * is holding jobs back.
+	 */
+	auto saturated = m_running >= m_limit ;
+
+	if( busy || ( saturated && throughput * 10 < m_throughput * 7 ) ){
+
+		m_limit = m_limit > 1 ? m_limit / 2 : 1 ;
+
+	}else if( saturated && throughput >= m_throughput ){
+
+		m_limit++ ;
+	}
+
+	if( m_limit > maximum ){
+
+		m_limit = maximum ;
+	}
+
+	m_throughput = throughput ;
+
+	this->schedule() ;
+}
+
+
+bool scheduler::fits( const scheduler::key& key,int maxPerHost )
+{
+	if( maxPerHost > 0 && !key.host.isEmpty() ){
+
+		if( _count( m_hosts,key.host ) >= maxPerHost ){
+
+			return false ;
+		}
+	}
+
+	if( key.engineMaximum > 0 ){
+
+		if( _count( m_engines,key.engine ) >= key.engineMaximum ){
+
+			return false ;
+		}
+	}
+
+	return true ;
+}
+
+bool scheduler::ready( const scheduler::job& job )
+{
+	return !job.prefetch || job.resolved || m_settings.prefetchCount() <= 0 ;
+}
+
+void scheduler::prefetchAhead()
+{
+	auto count = m_settings.prefetchCount() ;
+
+	if( count <= 0 ){
+
+		return ;
+	}
+
+	auto maxPerHost = m_settings.maxConcurrentDownloadsPerHost() ;
+
+	for( size_t s = 0 ; s < m_queues.size() ; s++ ){
+
+		if( this->priorityOf( static_cast< scheduler::queue >( s ) ) != scheduler::priority::background ){
+
+			continue ;
+		}
+
+		auto& m = m_queues[ s ] ;
+
+		int window = 0 ;
+
+		/*
+		 * Jobs held back by their limits would not start soon anyway,
+		 * they do not take a place in the window.
+		 */
+		for( size_t e = 0 ; e < m.queued.size() ; e++ ){
+
+			if( window >= count || static_cast< int >( m_prefetching.size() ) >= count ){
+
+				break ;
+			}
+
+			auto& job = m.queued[ e ] ;
+
+			if( !this->fits( job.key,maxPerHost ) ){
+
+				continue ;
+			}
+
+			window++ ;
+
+			if( job.prefetch && !job.resolving && !job.resolved ){
+
+				job.resolving = true ;
+
+				auto id = job.id ;
+
+				m_prefetching[ id ] = m_clock.elapsed() ;
+
+				job.prefetch( [ this,id ](){
+
+					this->resolved( id ) ;
+				} ) ;
+			}
+		}
+	}
+}
+
+void scheduler::resolved( int id )
+{
+	/*
+	 * Already given up on by prefetchTimeouts().
+	 */
+	if( m_prefetching.erase( id ) == 0 ){
+
+		return ;
+	}
+
+	for( auto& m : m_queues ){
+
+		for( auto& it : m.queued ){
+
+			if( it.id == id ){
+
+				it.resolving = false ;
+				it.resolved = true ;
+			}
+		}
+	}
+
+	this->schedule() ;
+}
+
+/*
+ * A prefetch that never reports back, like one whose process failed to
+ * start, must not hold its job back for ever. The job then starts and does
+ * its own extraction.
+ */
+void scheduler::prefetchTimeouts()
+{
+	auto now = m_clock.elapsed() ;
+
+	std::vector< int > m ;
+
+	for( const auto& it : m_prefetching ){
+
+		if( now - it.second > 60000 ){
+
+			m.emplace_back( it.first ) ;
+		}
+	}
+
+	for( const auto& it : m ){
+
+		this->resolved( it ) ;
+	}
+}
+
+scheduler::next scheduler::nextJob( scheduler::priority p )
+{
+	scheduler::next next{ -1,0 } ;
+
+	auto maxPerHost = m_settings.maxConcurrentDownloadsPerHost() ;
+
+	/*
+	 * Starting from the queue after the last one served makes ties go
+	 * round robin.
+	 */
+	for( size_t i = 0 ; i < m_queues.size() ; i++ ){
+
+		auto s = ( m_next + i ) % m_queues.size() ;
+
+		const auto& m = m_queues[ s ] ;
+
+		if( m.queued.empty() || this->priorityOf( static_cast< scheduler::queue >( s ) ) != p ){
+
+			continue ;
+		}
+
+		if( next.queue != -1 && m.running >= m_queues[ static_cast< size_t >( next.queue ) ].running ){
+
+			continue ;
+		}
+
+		if( p == scheduler::priority::interactive ){
+
+			/*
+			 * Jobs the user started keep their order, the oldest one
+			 * waits for its host or engine to have room.
+			 */
+			if( this->fits( m.queued.front().key,maxPerHost ) ){
+
+				next = { static_cast< int >( s ),0 } ;
+			}
+
+			continue ;
+		}
+
+		/*
+		 * A job whose prefetch is running is left to it, it starts as
+		 * soon as the prefetch is done.
+		 */
+		auto position = m.queued.size() ;
+
+		for( size_t e = 0 ; e < m.queued.size() ; e++ ){
+
+			const auto& job = m.queued[ e ] ;
+
+			if( !this->fits( job.key,maxPerHost ) ){
+
+				continue ;
+			}
+
+			if( this->ready( job ) ){
+
+				position = e ;
+
+				break ;
+
+			}else if( position == m.queued.size() && !job.resolving ){
+
+				position = e ;
+			}
+		}
+
+		if( position != m.queued.size() ){
+
+			next = { static_cast< int >( s ),position } ;
+		}
+	}
+
+	return next ;
+}
+
+void scheduler::start( const scheduler::next& next )
+{
+	auto s = static_cast< size_t >( next.queue ) ;
+
+	auto& m = m_queues[ s ] ;
+
+	auto it = m.queued.begin() + static_cast< std::ptrdiff_t >( next.position ) ;
+
+	auto job = std::move( *it ) ;
+
+	m.queued.erase( it ) ;
+
+	m.running++ ;
+	m_running++ ;
+
+	m_hosts[ job.key.host ]++ ;
+	m_engines[ job.key.engine ]++ ;
+
+	m_next = ( s + 1 ) % m_queues.size() ;
+
+	job.function() ;
+}
+
+void scheduler::schedule()
+{
+	/*
+	 * A job may finish while it is being started, the outer call will
+	 * pick up the freed slot.
+	 */
+	if( m_scheduling ){
+
+		return ;
+	}
+
+	m_scheduling = true ;
+
+	while( true ){
+
+		/*
+		 * Running interactive jobs still count against the limits so
+		 * background work backs off until they are done.
+		 */
+		auto s = this->nextJob( scheduler::priority::interactive ) ;
+
+		if( s.queue == -1 && m_running < this->maximum() ){
+
+			s = this->nextJob( scheduler::priority::background ) ;
+		}
+
+		if( s.queue == -1 ){
+
+			break ;
+		}
+
+		this->start( s ) ;
+	}
+
+	/*
+	 * Free slots are filled first, what is left waiting is prefetched
+	 * for when they are busy.
+	 */
+	this->prefetchAhead() ;
+
+	m_scheduling = false ;
+}
@@ -0,0 +1,198 @@
+/*
+ *
+ *  Copyright (c) 2021
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <QString>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <map>
+
+#include "engines.h"
+
+class settings ;
+
+/*
+ * One admission limit for downloads started from any tab. Every tab has its
+ * own queue and a free slot goes to the queue with the fewest running jobs
+ * so one big batch can not starve the others.
+ *
+ * Jobs of interactive queues start as soon as they are submitted even if
+ * that takes the number of running jobs over the limit, background queues
+ * only get what is left of it.
+ *
+ * Every job also has to fit under the per host and per engine limits. A
+ * background job that does not is skipped over for a later one in the same
+ * queue so a busy site does not leave slots idle, an interactive one waits
+ * so that jobs the user started run in order.
+ *
+ * Background jobs can come with a prefetch stage that resolves what the
+ * download needs ahead of time. Free slots are filled first, then the first
+ * "PrefetchCount" jobs still waiting in every background queue that fit
+ * their limits are prefetched while the slots are busy transferring. A
+ * resolved job is started before one that is not, a free slot with no
+ * resolved job waiting starts one whose prefetch did not begin yet and the
+ * job then does its own extraction.
+ *
+ * With "AutoConcurrentDownloads" set, the limit is a value between 1 and
+ * maxConcurrentDownloads() that is raised by one while the combined
+ * download speed keeps going up and halved when it drops or when the
+ * machine is busy waiting on the cpu or the disk.
+ */
+class scheduler
+{
+public:
+	enum class queue{ basic,batch,playlist } ;
+	enum class priority{ interactive,background } ;
+
+	static scheduler::priority priorityOf( scheduler::queue ) ;
+
+	/*
+	 * Where a job goes. host is the engine's "ConcurrencyKey" if it has
+	 * one and the host part of the url otherwise.
+	 */
+	class key
+	{
+	public:
+		key() = default ;
+		key( const engines::engine&,const QString& url ) ;
+		QString host ;
+		QString engine ;
+		int engineMaximum = 0 ;
+	} ;
+
+	scheduler( settings& ) ;
+	/*
+	 * Called with a function to call once the prefetch is done, whether
+	 * it worked or not.
+	 */
+	using prefetcher = std::function< void( std::function< void() > ) > ;
+	/*
+	 * job is called once a slot is free, finished() must be called with
+	 * the same queue and key when whatever job started is done.
+	 */
+	void submit( scheduler::queue,
+		     scheduler::key,
+		     std::function< void() > job,
+		     scheduler::prefetcher prefetch = nullptr ) ;
+	void finished( scheduler::queue,const scheduler::key& ) ;
+	/*
+	 * Drops jobs of the queue that did not start yet, returns true if
+	 * there were any.
+	 */
+	bool cancel( scheduler::queue ) ;
+	/*
+	 * Called after the concurrency settings changed, a higher limit
+	 * starts queued jobs now and a lower one lets running jobs finish
+	 * without starting new ones.
+	 */
+	void limitsChanged() ;
+	/*
+	 * Feeds the download speed of the job with the given logger id to
+	 * the automatic limit.
+	 */
+	void progress( int id,const engines::engine::functions::event& ) ;
+	class reporter
+	{
+	public:
+		reporter( scheduler& s,int id ) : m_scheduler( s ),m_id( id )
+		{
+		}
+		void operator()( const engines::engine::functions::event& e ) const
+		{
+			m_scheduler.progress( m_id,e ) ;
+		}
+	private:
+		scheduler& m_scheduler ;
+		int m_id ;
+	} ;
+	scheduler::reporter reporterFor( int id )
+	{
+		return { *this,id } ;
+	}
+	int running() const
+	{
+		return m_running ;
+	}
+private:
+	struct job
+	{
+		int id ;
+		scheduler::key key ;
+		std::function< void() > function ;
+		scheduler::prefetcher prefetch ;
+		bool resolving = false ;
+		bool resolved = false ;
+	} ;
+	struct jobs
+	{
+		std::deque< scheduler::job > queued ;
+		int running = 0 ;
+	} ;
+	struct next
+	{
+		int queue ;
+		size_t position ;
+	} ;
+	scheduler::jobs& jobsOf( scheduler::queue ) ;
+	int maximum() ;
+	bool fits( const scheduler::key&,int maxPerHost ) ;
+	bool ready( const scheduler::job& ) ;
+	void prefetchAhead() ;
+	void resolved( int id ) ;
+	void prefetchTimeouts() ;
+	scheduler::next nextJob( scheduler::priority ) ;
+	void start( const scheduler::next& ) ;
+	void schedule() ;
+	void adjust() ;
+	qint64 throughput() ;
+	struct speed
+	{
+		qint64 bytesPerSecond ;
+		qint64 time ;
+	} ;
+	struct cpuTimes
+	{
+		qint64 total = 0 ;
+		qint64 idle = 0 ;
+		qint64 ioWait = 0 ;
+	} ;
+	settings& m_settings ;
+	std::array< scheduler::jobs,3 > m_queues ;
+	std::map< QString,int > m_hosts ;
+	std::map< QString,int > m_engines ;
+	std::map< int,scheduler::speed > m_speeds ;
+	std::map< int,qint64 > m_prefetching ;
+	QTimer m_timer ;
+	QElapsedTimer m_clock ;
+	scheduler::cpuTimes m_cpuTimes ;
+	qint64 m_throughput = 0 ;
+	size_t m_next = 0 ;
+	int m_ids = 0 ;
+	int m_running = 0 ;
+	int m_limit = 0 ;
+	bool m_scheduling = false ;
+} ;
+
+#endif
@@ -105,11 +105,126 @@ int settings::maxConcurrentDownloads()
 	return m_settings.value( "MaxConcurrentDownloads" ).toInt() ;
 }
 
+int settings::maxConcurrentDownloadsPerHost()
+{
+	/*
+	 * 0 means only the global limit applies.
+	 */
+	if( !m_settings.contains( "MaxConcurrentDownloadsPerHost" ) ){
+
+		m_settings.setValue( "MaxConcurrentDownloadsPerHost",0 ) ;
+	}
+
+	return m_settings.value( "MaxConcurrentDownloadsPerHost" ).toInt() ;
+}
+
+int settings::prefetchCount()
+{
+	/*
+	 * How many queued jobs get their metadata resolved ahead of a free
+	 * slot, 0 turns prefetching off. A free slot never waits on a job
+	 * that is still resolving, so a small window only costs a few
+	 * extractions that run alongside the transfers.
+	 */
+	if( !m_settings.contains( "PrefetchCount" ) ){
+
+		m_settings.setValue( "PrefetchCount",2 ) ;
+	}
+
+	return m_settings.value( "PrefetchCount" ).toInt() ;
+}
+
+int settings::urlsPerProcess()
+{
+	/*
+	 * More than 1 packs that many queued urls into one engine process
+	 * when the engine supports it.
+	 */
+	if( !m_settings.contains( "UrlsPerProcess" ) ){
+
+		m_settings.setValue( "UrlsPerProcess",1 ) ;
+	}
+
+	return m_settings.value( "UrlsPerProcess" ).toInt() ;
+}
+
+int settings::metadataCacheTimeToLive()
+{
+	/*
+	 * In seconds, 0 turns the metadata cache off.
+	 */
+	if( !m_settings.contains( "MetadataCacheTimeToLive" ) ){
+
+		m_settings.setValue( "MetadataCacheTimeToLive",24 * 60 * 60 ) ;
+	}
+
+	return m_settings.value( "MetadataCacheTimeToLive" ).toInt() ;
+}
+
+size_t settings::maxLoggerLines()
+{
+	if( !m_settings.contains( "MaxLoggerLines" ) ){
+
+		m_settings.setValue( "MaxLoggerLines",10000 ) ;
+	}
+
+	return m_settings.value( "MaxLoggerLines" ).toULongLong() ;
+}
+
+size_t settings::maxLoggerSize()
+{
+	if( !m_settings.contains( "MaxLoggerSizeInBytes" ) ){
+
+		m_settings.setValue( "MaxLoggerSizeInBytes",8 * 1024 * 1024 ) ;
+	}
+
+	return m_settings.value( "MaxLoggerSizeInBytes" ).toULongLong() ;
+}
+
+qint64 settings::maxLogHistorySize()
+{
+	/*
+	 * The newest half is kept when the file of evicted log lines grows
+	 * past this.
+	 */
+	if( !m_settings.contains( "MaxLogHistorySizeInBytes" ) ){
+
+		m_settings.setValue( "MaxLogHistorySizeInBytes",64 * 1024 * 1024 ) ;
+	}
+
+	return m_settings.value( "MaxLogHistorySizeInBytes" ).toLongLong() ;
+}
+
 void settings::setMaxConcurrentDownloads( int s )
 {
 	m_settings.setValue( "MaxConcurrentDownloads",s ) ;
 }
 
+void settings::setMaxConcurrentDownloadsPerHost( int s )
+{
+	m_settings.setValue( "MaxConcurrentDownloadsPerHost",s ) ;
+}
+
+void settings::setPrefetchCount( int s )
+{
+	m_settings.setValue( "PrefetchCount",s ) ;
+}
+
+void settings::setUrlsPerProcess( int s )
+{
+	m_settings.setValue( "UrlsPerProcess",s ) ;
+}
+
+void settings::setMaxLoggerLines( size_t s )
+{
+	m_settings.setValue( "MaxLoggerLines",static_cast< qulonglong >( s ) ) ;
+}
+
+void settings::setMaxLoggerSize( size_t s )
+{
+	m_settings.setValue( "MaxLoggerSizeInBytes",static_cast< qulonglong >( s ) ) ;
+}
+
 void settings::setDownloadFolder( const QString& m )
 {
 	m_settings.setValue( "DownloadFolder",m ) ;
@@ -257,6 +372,16 @@ bool settings::concurrentDownloading()
 	return m_settings.value( "ConcurrentDownloading" ).toBool() ;
 }
 
+bool settings::autoConcurrentDownloads()
+{
+	if( !m_settings.contains( "AutoConcurrentDownloads" ) ){
+
+		m_settings.setValue( "AutoConcurrentDownloads",false ) ;
+	}
+
+	return m_settings.value( "AutoConcurrentDownloads" ).toBool() ;
+}
+
 bool settings::useSystemProvidedVersionIfAvailable()
 {
 	if( !m_settings.contains( "UseSystemProvidedVersionIfAvailable" ) ){
@@ -282,6 +407,16 @@ bool settings::doNotGetUrlTitle()
 	return m_settings.value( "DoNotGetURLTitle" ).toBool() ;
 }
 
+bool settings::logHistoryOnDisk()
+{
+	if( !m_settings.contains( "LogHistoryOnDisk" ) ){
+
+		m_settings.setValue( "LogHistoryOnDisk",false ) ;
+	}
+
+	return m_settings.value( "LogHistoryOnDisk" ).toBool() ;
+}
+
 void settings::setUseSystemProvidedVersionIfAvailable( bool e )
 {
 	m_settings.setValue( "UseSystemProvidedVersionIfAvailable",e ) ;
@@ -292,6 +427,16 @@ void settings::setConcurrentDownloading( bool e )
 	m_settings.setValue( "ConcurrentDownloading",e ) ;
 }
 
+void settings::setAutoConcurrentDownloads( bool e )
+{
+	m_settings.setValue( "AutoConcurrentDownloads",e ) ;
+}
+
+void settings::setLogHistoryOnDisk( bool e )
+{
+	m_settings.setValue( "LogHistoryOnDisk",e ) ;
+}
+
 void settings::setShowVersionInfoWhenStarting( bool e )
 {
 	m_settings.setValue( "ShowVersionInfoWhenStarting",e ) ;
@@ -39,6 +39,14 @@ public:
 
 	int tabNumber() ;
 	int maxConcurrentDownloads() ;
+	int maxConcurrentDownloadsPerHost() ;
+	int prefetchCount() ;
+	int urlsPerProcess() ;
+	int metadataCacheTimeToLive() ;
+
+	size_t maxLoggerLines() ;
+	size_t maxLoggerSize() ;
+	qint64 maxLogHistorySize() ;
 
 	QString downloadFolder() ;
 	QString downloadFolder( Logger& ) ;
@@ -64,11 +72,20 @@ public:
 	bool autoDownload() ;
 	bool showVersionInfoWhenStarting() ;
 	bool concurrentDownloading() ;
+	bool autoConcurrentDownloads() ;
 	bool useSystemProvidedVersionIfAvailable() ;
 	bool doNotGetUrlTitle() ;
+	bool logHistoryOnDisk() ;
 
 	void setUseSystemProvidedVersionIfAvailable( bool ) ;
 	void setMaxConcurrentDownloads( int ) ;
+	void setMaxConcurrentDownloadsPerHost( int ) ;
+	void setPrefetchCount( int ) ;
+	void setUrlsPerProcess( int ) ;
+	void setMaxLoggerLines( size_t ) ;
+	void setMaxLoggerSize( size_t ) ;
+	void setAutoConcurrentDownloads( bool ) ;
+	void setLogHistoryOnDisk( bool ) ;
 	void setTabNumber( int ) ;
 	void setConcurrentDownloading( bool ) ;
 	void setShowVersionInfoWhenStarting( bool ) ;
@@ -27,6 +27,9 @@
 #include "configure.h"
 #include "playlistdownloader.h"
 #include "context.hpp"
+#include "scheduler.h"
+#include "workerpool.h"
+#include "metadatacache.h"
 
 class tabManager
 {
@@ -39,7 +42,10 @@ public:
 		    QWidget& w,
 		    MainWindow& mw ) :
 		m_currentTab( s.tabNumber() ),
-		m_ctx( s,t,m,w,mw,l,e,*this ),
+		m_scheduler( s ),
+		m_workerPool( s,e,l ),
+		m_metadataCache( s,e,l ),
+		m_ctx( s,t,m,w,mw,l,e,*this,m_scheduler,m_workerPool,m_metadataCache ),
 		m_about( m_ctx ),
 		m_configure( m_ctx ),
 		m_basicdownloader( m_ctx ),
@@ -80,14 +86,59 @@ public:
 
 		m.tabWidget->setCurrentIndex( s.tabNumber() ) ;
 	}
+	/*
+	 * A tab with a download running or waiting for a slot only locks
+	 * itself and the configure tab, the other download tabs can still
+	 * submit their work to the scheduler.
+	 */
+	enum class tab{ basic = 1,batch = 2,playlist = 4 } ;
+
+	tabManager& setDownloading( tabManager::tab t,bool e )
+	{
+		auto m = static_cast< int >( t ) ;
+
+		if( e ){
+
+			m_downloading |= m ;
+
+			this->disableTab( t ) ;
+
+			m_configure.disableAll() ;
+		}else{
+			m_downloading &= ~m ;
+
+			this->enableAll() ;
+		}
+
+		return *this ;
+	}
+	/*
+	 * Tabs with a download running stay locked.
+	 */
 	tabManager& enableAll()
 	{
 		m_about.enableAll() ;
-		m_configure.enableAll() ;
-		m_basicdownloader.enableAll() ;
-		m_batchdownloader.enableAll() ;
-		m_batchfiledownloader.enableAll() ;
-		m_playlistdownloader.enableAll() ;
+
+		if( m_downloading == 0 ){
+
+			m_configure.enableAll() ;
+		}
+
+		if( !this->downloading( tab::basic ) ){
+
+			m_basicdownloader.enableAll() ;
+		}
+
+		if( !this->downloading( tab::batch ) ){
+
+			m_batchdownloader.enableAll() ;
+			m_batchfiledownloader.enableAll() ;
+		}
+
+		if( !this->downloading( tab::playlist ) ){
+
+			m_playlistdownloader.enableAll() ;
+		}
 
 		return *this ;
 	}
@@ -141,7 +192,39 @@ public:
 		return m_configure ;
 	}
 private:
+	bool downloading( tabManager::tab t ) const
+	{
+		return m_downloading & static_cast< int >( t ) ;
+	}
+	void disableTab( tabManager::tab t )
+	{
+		switch( t ){
+
+		case tab::basic :
+
+			m_basicdownloader.disableAll() ;
+
+			break ;
+
+		case tab::batch :
+
+			m_batchdownloader.disableAll() ;
+			m_batchfiledownloader.disableAll() ;
+
+			break ;
+
+		case tab::playlist :
+
+			m_playlistdownloader.disableAll() ;
+
+			break ;
+		}
+	}
+	int m_downloading = 0 ;
 	int m_currentTab ;
+	scheduler m_scheduler ;
+	workerPool m_workerPool ;
+	metadataCache m_metadataCache ;
 	Context m_ctx ;
 	about m_about ;
 	configure m_configure ;
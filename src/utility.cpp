@@ -25,10 +25,14 @@
 
 #include <QEventLoop>
 #include <QDesktopServices>
+#include <QThread>
+#include <QEvent>
+#include <QCoreApplication>
 
-const char * utility::selectedAction::CLEAROPTIONS = "Clear Options" ;
-const char * utility::selectedAction::CLEARSCREEN  = "Clear Screen" ;
-const char * utility::selectedAction::OPENFOLDER   = "Open Download Folder" ;
+const char * utility::selectedAction::CLEAROPTIONS       = "Clear Options" ;
+const char * utility::selectedAction::CLEARSCREEN        = "Clear Screen" ;
+const char * utility::selectedAction::OPENFOLDER         = "Open Download Folder" ;
+const char * utility::selectedAction::CLEARMETADATACACHE = "Clear Metadata Cache" ;
 
 QStringList utility::split( const QString& e,char token,bool skipEmptyParts )
 {
@@ -62,6 +66,180 @@ QList<QByteArray> utility::split( const QByteArray& e,QChar token )
 	return e.split( token.toLatin1() ) ;
 }
 
+namespace
+{
+	class task : public QEvent
+	{
+	public:
+		task( std::function< void() > work,
+		      std::function< void() > then = {},
+		      QObject * thenReceiver = nullptr ) :
+			QEvent( QEvent::User ),
+			m_work( std::move( work ) ),
+			m_then( std::move( then ) ),
+			m_thenReceiver( thenReceiver )
+		{
+		}
+		void run()
+		{
+			m_work() ;
+
+			if( m_then ){
+
+				/*
+				 * "then" is moved and not copied so that whatever it
+				 * holds is released on the thread that runs it.
+				 */
+				QCoreApplication::postEvent( m_thenReceiver,new task( std::move( m_then ) ) ) ;
+			}
+		}
+	private:
+		std::function< void() > m_work ;
+		std::function< void() > m_then ;
+		QObject * m_thenReceiver ;
+	} ;
+
+	class taskRunner : public QObject
+	{
+	public:
+		bool event( QEvent * e ) override
+		{
+			if( e->type() == QEvent::User ){
+
+				static_cast< task * >( e )->run() ;
+
+				return true ;
+			}else{
+				return QObject::event( e ) ;
+			}
+		}
+	} ;
+
+	class backgroundThread
+	{
+	public:
+		backgroundThread()
+		{
+			m_worker->moveToThread( m_thread ) ;
+
+			m_thread->start() ;
+
+			auto thread = m_thread ;
+
+			QObject::connect( QCoreApplication::instance(),&QCoreApplication::aboutToQuit,[ thread ](){
+
+				thread->quit() ;
+				thread->wait() ;
+			} ) ;
+		}
+		void post( std::function< void() > work,std::function< void() > then )
+		{
+			QCoreApplication::postEvent( m_worker,new task( std::move( work ),std::move( then ),m_gui ) ) ;
+		}
+	private:
+		/*
+		 * These live as long as the application does.
+		 */
+		QThread * m_thread = new QThread() ;
+		taskRunner * m_worker = new taskRunner() ;
+		taskRunner * m_gui = new taskRunner() ;
+	} ;
+}
+
+utility::lineAssembler::lineAssembler( const QStringList& sp )
+{
+	/*
+	 * Same separators engines::engine::functions::processData() splits on.
+	 */
+	if( sp.size() == 1 && sp[ 0 ].size() > 0 ){
+
+		m_separators = { sp[ 0 ][ 0 ].toLatin1(),'\0' } ;
+		m_separatorsCount = 1 ;
+
+	}else if( sp.size() == 2 && sp[ 0 ].size() > 0 && sp[ 1 ].size() > 0 ){
+
+		m_separators = { sp[ 0 ][ 0 ].toLatin1(),sp[ 1 ][ 0 ].toLatin1() } ;
+		m_separatorsCount = 2 ;
+	}else{
+		m_separators = { '\r','\n' } ;
+		m_separatorsCount = 2 ;
+	}
+}
+
+int utility::lineAssembler::lastSeparator( const QByteArray& e ) const
+{
+	for( auto i = e.size() - 1 ; i >= 0 ; i-- ){
+
+		auto c = e.at( i ) ;
+
+		for( int s = 0 ; s < m_separatorsCount ; s++ ){
+
+			if( c == m_separators[ static_cast< size_t >( s ) ] ){
+
+				return i ;
+			}
+		}
+	}
+
+	return -1 ;
+}
+
+QByteArray utility::lineAssembler::add( const QByteArray& data )
+{
+	if( m_buffer.isEmpty() ){
+
+		auto s = this->lastSeparator( data ) ;
+
+		if( s == data.size() - 1 ){
+
+			/*
+			 * The common case, the chunk ends with a complete line
+			 * and is passed along without a copy.
+			 */
+			return data ;
+		}
+
+		m_buffer.append( data.constData() + s + 1,data.size() - s - 1 ) ;
+
+		return data.left( s + 1 ) ;
+	}else{
+		m_buffer += data ;
+
+		auto s = this->lastSeparator( m_buffer ) ;
+
+		if( s == -1 ){
+
+			return {} ;
+		}
+
+		auto m = m_buffer.left( s + 1 ) ;
+
+		/*
+		 * Removing from the front keeps the allocation around for
+		 * the next chunk.
+		 */
+		m_buffer.remove( 0,s + 1 ) ;
+
+		return m ;
+	}
+}
+
+QByteArray utility::lineAssembler::takeRest()
+{
+	auto m = m_buffer ;
+
+	m_buffer.clear() ;
+
+	return m ;
+}
+
+void utility::runInBackground( std::function< void() > work,std::function< void() > then )
+{
+	static backgroundThread thread ;
+
+	thread.post( std::move( work ),std::move( then ) ) ;
+}
+
 #ifdef Q_OS_LINUX
 
 bool utility::platformIsLinux()
@@ -358,6 +536,12 @@ QMenu * utility::details::sMo( const Context& ctx,
 						   utility::selectedAction::OPENFOLDER ) ;
 
 		translator.addAction( menu,std::move( mm ) ) ;
+
+		translator::entry mc( QObject::tr( "Clear Metadata Cache" ),
+						   utility::selectedAction::CLEARMETADATACACHE,
+						   utility::selectedAction::CLEARMETADATACACHE ) ;
+
+		translator.addAction( menu,std::move( mc ) ) ;
 	}
 
 	w->setMenu( menu ) ;
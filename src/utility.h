@@ -29,6 +29,8 @@
 
 #include <type_traits>
 #include <memory>
+#include <functional>
+#include <array>
 
 #include "translator.h"
 
@@ -99,6 +101,7 @@ namespace utility
 		static const char * CLEARSCREEN ;
 		static const char * CLEAROPTIONS ;
 		static const char * OPENFOLDER ;
+		static const char * CLEARMETADATACACHE ;
 
 		selectedAction( QAction * ac ) : m_ac( ac )
 		{
@@ -115,6 +118,10 @@ namespace utility
 		{
 			return m_ac->objectName() == utility::selectedAction::OPENFOLDER ;
 		}
+		bool clearMetadataCache() const
+		{
+			return m_ac->objectName() == utility::selectedAction::CLEARMETADATACACHE ;
+		}
 		QString text() const
 		{
 			return m_ac->text() ;
@@ -323,21 +330,72 @@ namespace utility
 		QProcess::ProcessChannel m_channel ;
 	} ;
 
+	/*
+	 * work is called on a background thread and then is called on the gui
+	 * thread once work is done. Calls are processed in the order they are made.
+	 */
+	void runInBackground( std::function< void() > work,std::function< void() > then ) ;
+
+	/*
+	 * Process output arrives in chunks that do not respect line boundaries,
+	 * this class holds back the incomplete last line of a chunk until the
+	 * rest of it arrives.
+	 */
+	class lineAssembler
+	{
+	public:
+		lineAssembler( const QStringList& splitLinesBy ) ;
+		/*
+		 * Returns the complete lines seen so far.
+		 */
+		QByteArray add( const QByteArray& data ) ;
+		/*
+		 * Returns whatever is left, called once the process is done.
+		 */
+		QByteArray takeRest() ;
+		/*
+		 * Returns the incomplete last line without taking it, add()
+		 * still returns it once it is complete.
+		 */
+		QByteArray partial() const
+		{
+			return m_buffer ;
+		}
+	private:
+		int lastSeparator( const QByteArray& ) const ;
+		QByteArray m_buffer ;
+		std::array< char,2 > m_separators ;
+		int m_separatorsCount ;
+	} ;
+
 	template< typename Tlogger,
 		  typename Options >
-	class context
+	class context : public std::enable_shared_from_this< context< Tlogger,Options > >
 	{
 	public:
 		context( const engines::engine& engine,
 			 Tlogger logger,
 			 Options options,
 			 ProcessOutputChannels channels ) :
-			m_engine( engine ),
+			m_engine( std::make_shared< const engines::engine >( engine ) ),
 			m_logger( std::move( logger ) ),
+			m_parser( std::make_shared< parser >( engine ) ),
 			m_postData( true ),
 			m_options( std::move( options ) ),
 			m_channels( channels )
 		{
+			/*
+			 * A prompt for a password or a code has no line end and
+			 * the engine waits for an answer, what has been held back
+			 * is shown once output stops for a moment.
+			 */
+			m_partialLineTimer.setSingleShot( true ) ;
+			m_partialLineTimer.setInterval( 250 ) ;
+
+			QObject::connect( &m_partialLineTimer,&QTimer::timeout,[ this ](){
+
+				this->parse( QByteArray(),chunk::partial,[](){} ) ;
+			} ) ;
 		}
 		void setCancelConnection( QMetaObject::Connection conn )
 		{
@@ -346,19 +404,31 @@ namespace utility
 		void stopReceivingData()
 		{
 			m_postData = false ;
+
+			m_partialLineTimer.stop() ;
 		}
 		void postData( QByteArray data )
 		{
 			if( m_postData ){
 
-				m_data += data ;
+				this->capture( data ) ;
 
-				m_logger.add( [ this,data = std::move( data ) ]( Logger::Data& e,int id ){
+				this->parse( std::move( data ),chunk::complete,[](){} ) ;
 
-					m_engine.processData( e,std::move( data ),id ) ;
-				} ) ;
+				m_partialLineTimer.start() ;
 			}
 		}
+		/*
+		 * Function is called on the gui thread after all data posted so
+		 * far has been parsed and added to the logger.
+		 */
+		template< typename Function >
+		void whenDataProcessed( Function function )
+		{
+			m_partialLineTimer.stop() ;
+
+			this->parse( QByteArray(),chunk::last,std::move( function ) ) ;
+		}
 		template< typename Function >
 		void listRequested( Function function )
 		{
@@ -371,6 +441,10 @@ namespace utility
 		{
 			QObject::disconnect( m_conn ) ;
 		}
+		void flush()
+		{
+			m_logger.flush() ;
+		}
 		Options& options()
 		{
 			return m_options ;
@@ -380,14 +454,117 @@ namespace utility
 			return m_channels ;
 		}
 	private:
-		const engines::engine& m_engine ;
+		/*
+		 * Output is only kept for listRequested() when Options allows it
+		 * and never grows past the limit Options sets.
+		 */
+		void capture( const QByteArray& data )
+		{
+			if( Options::maxCapturedOutputSize > 0 && m_options.listRequested() ){
+
+				auto s = Options::maxCapturedOutputSize - m_data.size() ;
+
+				if( s >= data.size() ){
+
+					m_data += data ;
+
+				}else if( s > 0 ){
+
+					m_data.append( data.constData(),s ) ;
+				}
+			}
+		}
+		/*
+		 * Only used on the background thread.
+		 */
+		struct parser
+		{
+			parser( const engines::engine& engine ) :
+				lines( engine.splitLinesBy() )
+			{
+			}
+			utility::lineAssembler lines ;
+			Logger::jobData jobData ;
+			bool partialLineShown = false ;
+		} ;
+		/*
+		 * complete passes on the complete lines of data, partial shows
+		 * the incomplete last line and last takes everything that is left.
+		 */
+		enum class chunk{ complete,partial,last } ;
+		template< typename Function >
+		void parse( QByteArray data,chunk c,Function function )
+		{
+			auto update = std::make_shared< Logger::jobData::update >() ;
+
+			std::weak_ptr< context > self = this->shared_from_this() ;
+
+			auto work = [ engine = m_engine,parser = m_parser,update,c,data = std::move( data ) ](){
+
+				QByteArray m ;
+
+				if( c == chunk::complete ){
+
+					m = parser->lines.add( data ) ;
+
+				}else if( c == chunk::partial ){
+
+					m = parser->lines.partial() ;
+				}else{
+					m = parser->lines.takeRest() ;
+				}
+
+				if( !m.isEmpty() ){
+
+					/*
+					 * A partial line already shown is replaced by what
+					 * it turned into.
+					 */
+					if( parser->partialLineShown ){
+
+						parser->jobData.lines().removeLast() ;
+					}
+
+					engine->processData( parser->jobData.lines(),std::move( m ),Logger::jobData::id ) ;
+
+					*update = parser->jobData.take() ;
+
+					parser->partialLineShown = c == chunk::partial && !update->isEmpty() ;
+
+					update->setLogLines( [ &engine ]( QString& e ){
+
+						return engine->stripParserText( e ) ;
+					} ) ;
+				}
+			} ;
+
+			utility::runInBackground( std::move( work ),[ self = std::move( self ),update,function = std::move( function ) ](){
+
+				auto ctx = self.lock() ;
+
+				if( ctx && !update->isEmpty() ){
+
+					ctx->m_logger.add( *update ) ;
+				}
+
+				function() ;
+			} ) ;
+		}
+		/*
+		 * The parser thread reads the engine while the gui thread may
+		 * reload the engines, it gets a copy of its own. Copies share
+		 * the engine functions and matchers so making one is cheap.
+		 */
+		std::shared_ptr< const engines::engine > m_engine ;
 		bool m_list_requested ;
 		QMetaObject::Connection m_conn ;
 		Tlogger m_logger ;
+		std::shared_ptr< parser > m_parser ;
 		QByteArray m_data ;
 		bool m_postData ;
 		Options m_options ;
 		ProcessOutputChannels m_channels ;
+		QTimer m_partialLineTimer ;
 	} ;
 
 	template< typename Connection,
@@ -444,12 +621,21 @@ namespace utility
 
 			ctx->disconnect() ;
 
-			ctx->listRequested( [ & ]( const QList< QByteArray >& e ){
+			ctx->whenDataProcessed( [ ctx,s,e ](){
 
-				ctx->options().listRequested( e ) ;
-			} ) ;
+				/*
+				 * Render what is still waiting for the next frame before
+				 * the finished state is written over it.
+				 */
+				ctx->flush() ;
 
-			ctx->options().done( s == 0 && e == QProcess::ExitStatus::NormalExit ) ;
+				ctx->listRequested( [ & ]( const QList< QByteArray >& e ){
+
+					ctx->options().listRequested( e ) ;
+				} ) ;
+
+				ctx->options().done( s == 0 && e == QProcess::ExitStatus::NormalExit ) ;
+			} ) ;
 
 		},[]( QProcess::ProcessChannel channel,QByteArray data,std::shared_ptr< utility::context< Tlogger,Options > >& ctx ){
 
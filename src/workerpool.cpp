@@ -0,0 +1,433 @@
+/*
+ *
+ *  Copyright (c) 2021
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "workerpool.h"
+
+#include "settings.h"
+#include "logger.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include <algorithm>
+
+/*
+ * Kept next to the backends, rewritten on every start so it always matches
+ * the protocol of this build.
+ */
+static const char * _workerScript = R"python(import io
+import json
+import os
+import sys
+import zipfile
+
+if not zipfile.is_zipfile( sys.argv[ 2 ] ):
+    sys.exit( 1 )
+
+sys.path.insert( 0,sys.argv[ 2 ] )
+
+# The protocol keeps descriptors of its own, programs the engine runs
+# inherit stdin and stdout and must not read or write into it.
+requests = os.fdopen( os.dup( 0 ),"r",encoding = "utf-8" )
+protocol = os.fdopen( os.dup( 1 ),"w",encoding = "utf-8" )
+
+null = os.open( os.devnull,os.O_RDWR )
+
+os.dup2( null,0 )
+os.dup2( null,1 )
+
+def send( obj ):
+    protocol.write( json.dumps( obj ) + "\n" )
+    protocol.flush()
+
+class binaryChannel( io.RawIOBase ):
+
+    def __init__( self,text ):
+        self.text = text
+
+    def writable( self ):
+        return True
+
+    def write( self,data ):
+        self.text.write( bytes( data ).decode( "utf-8","replace" ) )
+        return len( data )
+
+    def fileno( self ):
+        return self.text.fileno()
+
+    def isatty( self ):
+        return False
+
+class channel( io.TextIOBase ):
+
+    encoding = "utf-8"
+    errors = "replace"
+
+    def __init__( self,id ):
+        self.id = id
+        self.buffer = binaryChannel( self )
+
+    def writable( self ):
+        return True
+
+    def write( self,text ):
+        if text:
+            send( { "id" : self.id,"data" : text } )
+        return len( text )
+
+    def fileno( self ):
+        return null
+
+    def isatty( self ):
+        return False
+
+module = __import__( sys.argv[ 1 ] )
+
+send( { "ready" : True } )
+
+while True:
+    line = requests.readline()
+    if not line:
+        break
+    try:
+        job = json.loads( line )
+    except ValueError:
+        continue
+    out = channel( job[ "id" ] )
+    environ = dict( os.environ )
+    os.environ.clear()
+    os.environ.update( job.get( "env",environ ) )
+    sys.stdin = io.StringIO( job.get( "stdin","" ) )
+    sys.stdout = out
+    sys.stderr = out
+    code = 0
+    try:
+        os.chdir( job[ "cwd" ] )
+        module.main( job[ "args" ] )
+    except SystemExit as e:
+        if e.code is None:
+            code = 0
+        elif isinstance( e.code,int ):
+            code = e.code
+        else:
+            out.write( str( e.code ) + "\n" )
+            code = 1
+    except BaseException as e:
+        out.write( "ERROR: " + str( e ) + "\n" )
+        code = 1
+    finally:
+        sys.stdin = sys.__stdin__
+        sys.stdout = protocol
+        sys.stderr = sys.__stderr__
+        os.environ.clear()
+        os.environ.update( environ )
+    send( { "id" : job[ "id" ],"exit" : code } )
+)python" ;
+
+/*
+ * A zip file ends with its end of central directory record, a zipapp has a
+ * shebang line in front of the zip and is found the same way.
+ */
+static bool _isZipFile( const QString& path )
+{
+	QFile file( path ) ;
+
+	if( !file.open( QIODevice::ReadOnly ) ){
+
+		return false ;
+	}
+
+	auto size = file.size() ;
+	auto tail = std::min( size,static_cast< qint64 >( 65536 + 22 ) ) ;
+
+	file.seek( size - tail ) ;
+
+	return file.read( tail ).lastIndexOf( QByteArray( "PK\x05\x06",4 ) ) != -1 ;
+}
+
+workerPool::workerPool( settings& s,engines& e,Logger& l ) :
+	m_script( engines::enginePaths( s ).binPath( "media-downloader-worker.py" ) ),
+	m_engines( e ),
+	m_logger( l )
+{
+	this->writeScript() ;
+
+	m_clock.start() ;
+
+	QObject::connect( &m_timer,&QTimer::timeout,[ this ](){
+
+		this->stopIdleWorkers() ;
+	} ) ;
+
+	m_timer.start( 30000 ) ;
+}
+
+workerPool::~workerPool()
+{
+	for( auto& it : m_workers ){
+
+		QObject::disconnect( it->exe,nullptr,nullptr,nullptr ) ;
+
+		it->exe->kill() ;
+		it->exe->waitForFinished( 1000 ) ;
+
+		delete it->exe ;
+	}
+}
+
+bool workerPool::usable( const engines::engine& engine )
+{
+	if( !engine.useWorkerProcesses() || m_broken.contains( engine.name() ) ){
+
+		return false ;
+	}
+
+	const auto& exe = engine.exePath().realExe() ;
+
+	auto it = m_zipApps.find( exe ) ;
+
+	if( it == m_zipApps.end() ){
+
+		it = m_zipApps.emplace( exe,_isZipFile( exe ) ).first ;
+	}
+
+	return it->second ;
+}
+
+int workerPool::start( const engines::engine& engine,
+		       const QStringList& args,
+		       const QString& cwd,
+		       const QProcessEnvironment& env,
+		       const QByteArray& input,
+		       std::function< void( QByteArray ) > data,
+		       std::function< void( int ) > done )
+{
+	auto& w = this->idleWorker( engine ) ;
+
+	w.job = ++m_jobId ;
+	w.data = std::move( data ) ;
+	w.done = std::move( done ) ;
+
+	QJsonObject obj ;
+
+	obj.insert( "id",w.job ) ;
+	obj.insert( "cwd",cwd ) ;
+	obj.insert( "args",QJsonArray::fromStringList( args ) ) ;
+
+	QJsonObject environment ;
+
+	for( const auto& it : env.keys() ){
+
+		environment.insert( it,env.value( it ) ) ;
+	}
+
+	obj.insert( "env",environment ) ;
+
+	if( !input.isEmpty() ){
+
+		obj.insert( "stdin",QString::fromUtf8( input ) ) ;
+	}
+
+	w.exe->write( QJsonDocument( obj ).toJson( QJsonDocument::Compact ) + "\n" ) ;
+
+	return w.job ;
+}
+
+void workerPool::cancel( int id )
+{
+	for( auto& it : m_workers ){
+
+		if( it->job == id ){
+
+			it->exe->kill() ;
+
+			break ;
+		}
+	}
+}
+
+workerPool::worker& workerPool::idleWorker( const engines::engine& engine )
+{
+	for( auto& it : m_workers ){
+
+		if( it->job == -1 && !it->stopping && it->engine == engine.name() ){
+
+			return *it ;
+		}
+	}
+
+	m_workers.emplace_back( std::make_unique< workerPool::worker >() ) ;
+
+	auto w = m_workers.back().get() ;
+
+	w->engine = engine.name() ;
+	w->exe = new QProcess() ;
+
+	w->exe->setProcessEnvironment( m_engines.processEnvironment() ) ;
+	w->exe->setProcessChannelMode( QProcess::ProcessChannelMode::ForwardedErrorChannel ) ;
+
+	QObject::connect( w->exe,&QProcess::readyReadStandardOutput,[ this,w ](){
+
+		w->buffer += w->exe->readAllStandardOutput() ;
+
+		this->received( *w ) ;
+	} ) ;
+
+	using process = void( QProcess::* )( int,QProcess::ExitStatus ) ;
+
+	QObject::connect( w->exe,static_cast< process >( &QProcess::finished ),[ this,w ]( int,QProcess::ExitStatus ){
+
+		this->finished( w ) ;
+	} ) ;
+
+	QObject::connect( w->exe,&QProcess::errorOccurred,[ this,w ]( QProcess::ProcessError e ){
+
+		if( e == QProcess::ProcessError::FailedToStart ){
+
+			this->finished( w ) ;
+		}
+	} ) ;
+
+	/*
+	 * The module has the engine's name and is imported from the backend,
+	 * usable() only lets zipapps through.
+	 */
+	auto module = engine.name() ;
+	module.replace( '-','_' ) ;
+
+	w->exe->start( m_engines.findExecutable( "python3" ),{ "-u",m_script,module,engine.exePath().realExe() } ) ;
+
+	return *w ;
+}
+
+void workerPool::received( workerPool::worker& w )
+{
+	while( true ){
+
+		auto s = w.buffer.indexOf( '\n' ) ;
+
+		if( s == -1 ){
+
+			break ;
+		}
+
+		auto obj = QJsonDocument::fromJson( w.buffer.left( s ) ).object() ;
+
+		w.buffer.remove( 0,s + 1 ) ;
+
+		if( obj.contains( "data" ) ){
+
+			if( w.data ){
+
+				w.data( obj.value( "data" ).toString().toUtf8() ) ;
+			}
+
+		}else if( obj.contains( "exit" ) ){
+
+			auto done = std::move( w.done ) ;
+
+			w.job = -1 ;
+			w.idleSince = m_clock.elapsed() ;
+			w.data = nullptr ;
+			w.done = nullptr ;
+
+			if( done ){
+
+				done( obj.value( "exit" ).toInt() ) ;
+			}
+
+		}else if( obj.contains( "ready" ) ){
+
+			w.ready = true ;
+		}
+	}
+}
+
+void workerPool::finished( workerPool::worker * w )
+{
+	auto it = std::find_if( m_workers.begin(),m_workers.end(),[ w ]( const std::unique_ptr< workerPool::worker >& e ){
+
+		return e.get() == w ;
+	} ) ;
+
+	if( it == m_workers.end() ){
+
+		return ;
+	}
+
+	auto worker = std::move( *it ) ;
+
+	m_workers.erase( it ) ;
+
+	worker->exe->deleteLater() ;
+
+	if( !worker->ready ){
+
+		/*
+		 * The import failed, most likely the backend is not something
+		 * python can load. Later jobs run the backend directly.
+		 */
+		if( !m_broken.contains( worker->engine ) ){
+
+			m_broken.append( worker->engine ) ;
+		}
+
+		m_logger.add( QObject::tr( "Failed to start a worker process for \"%1\"" ).arg( worker->engine ) ) ;
+	}
+
+	if( worker->done ){
+
+		worker->done( 1 ) ;
+	}
+}
+
+/*
+ * Workers are only worth keeping while jobs keep coming, a burst of jobs
+ * should not leave its interpreters around for the rest of the session.
+ */
+void workerPool::stopIdleWorkers()
+{
+	auto now = m_clock.elapsed() ;
+
+	for( const auto& it : m_workers ){
+
+		if( it->ready && it->job == -1 && !it->stopping && now - it->idleSince > 60000 ){
+
+			/*
+			 * The worker exits when its stdin ends, finished()
+			 * then removes it.
+			 */
+			it->stopping = true ;
+			it->exe->closeWriteChannel() ;
+		}
+	}
+}
+
+void workerPool::writeScript()
+{
+	QFile file( m_script ) ;
+
+	if( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ){
+
+		file.write( _workerScript ) ;
+	}else{
+		m_logger.add( QObject::tr( "Failed to open file for writing" ) + ": " + m_script ) ;
+	}
+}
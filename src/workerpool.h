@@ -0,0 +1,180 @@
+/*
+ *
+ *  Copyright (c) 2021
+ *  name : Francis Banyikwa
+ *  email: mhogomchungu@gmail.com
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QProcess>
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QProcessEnvironment>
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <map>
+
+#include "engines.h"
+#include "utility.h"
+
+class settings ;
+class Logger ;
+
+/*
+ * Long lived python processes that import youtube-dl or yt-dlp once and then
+ * run one download after another, so a job does not pay for starting the
+ * interpreter and loading the extractors.
+ *
+ * The protocol is one json object per line. A job is sent to a worker's
+ * stdin as {"id":1,"cwd":"...","args":[...],"env":{...},"stdin":"..."},
+ * the worker answers with {"ready":true} once after the import,
+ * {"id":1,"data":"..."} for every piece of output of the job and
+ * {"id":1,"exit":0} when the job is done. The output is parsed by the engine
+ * exactly like the output of a process of its own, events included.
+ *
+ * Only a backend that is a zipapp is run in a worker, it is imported from
+ * the file itself and not from whatever python finds installed. Workers
+ * left idle for a minute are stopped.
+ */
+class workerPool
+{
+public:
+	workerPool( settings&,engines&,Logger& ) ;
+	~workerPool() ;
+	/*
+	 * True if the engine's json sets "UseWorkerProcesses", its backend is
+	 * a zipapp and its workers did not fail to start before.
+	 */
+	bool usable( const engines::engine& ) ;
+	/*
+	 * Returns the id of the job, data and done are called on the gui
+	 * thread. done gets the exit code of the job. The job sees env as its
+	 * environment and input as its stdin.
+	 */
+	int start( const engines::engine&,
+		   const QStringList& args,
+		   const QString& cwd,
+		   const QProcessEnvironment& env,
+		   const QByteArray& input,
+		   std::function< void( QByteArray ) > data,
+		   std::function< void( int ) > done ) ;
+	/*
+	 * Stops the job by killing its worker, the job's done is called with
+	 * a failure.
+	 */
+	void cancel( int id ) ;
+
+	template< typename Connection,
+		  typename Tlogger,
+		  typename Options >
+	void run( const engines::engine& engine,
+		  const QStringList& args,
+		  const QString& quality,
+		  Options options,
+		  Tlogger logger,
+		  Connection conn )
+	{
+		options.tabManagerEnableAll( false ) ;
+
+		logger.add( "cmd: [worker] " + engine.name() + " \"" + args.join( "\" \"" ) + "\"" ) ;
+
+		auto df = options.downloadFolder() ;
+
+		if( !QFile::exists( df ) ){
+
+			QDir().mkpath( df ) ;
+		}
+
+		using ctx_t = utility::context< Tlogger,Options > ;
+
+		auto ctx = std::make_shared< ctx_t >( engine,std::move( logger ),std::move( options ),utility::ProcessOutputChannels() ) ;
+
+		const auto& env = ctx->options().processEnvironment() ;
+
+		auto input = engine.credentials( quality ) ;
+
+		auto id = this->start( engine,args,df,env,input,[ ctx ]( QByteArray data ){
+
+			if( ctx->options().debug() ){
+
+				qDebug() << data ;
+				qDebug() << "------------------------" ;
+			}
+
+			ctx->postData( std::move( data ) ) ;
+
+		},[ ctx ]( int s ){
+
+			ctx->disconnect() ;
+
+			ctx->whenDataProcessed( [ ctx,s ](){
+
+				ctx->flush() ;
+
+				ctx->listRequested( [ & ]( const QList< QByteArray >& e ){
+
+					ctx->options().listRequested( e ) ;
+				} ) ;
+
+				ctx->options().done( s == 0 ) ;
+			} ) ;
+		} ) ;
+
+		ctx->setCancelConnection( QObject::connect( conn.obj,conn.pointer,[ this,ctx,id ](){
+
+			ctx->stopReceivingData() ;
+
+			this->cancel( id ) ;
+		} ) ) ;
+	}
+private:
+	struct worker
+	{
+		QString engine ;
+		QProcess * exe ;
+		QByteArray buffer ;
+		bool ready = false ;
+		int job = -1 ;
+		qint64 idleSince = 0 ;
+		bool stopping = false ;
+		std::function< void( QByteArray ) > data ;
+		std::function< void( int ) > done ;
+	} ;
+	workerPool::worker& idleWorker( const engines::engine& ) ;
+	void received( workerPool::worker& ) ;
+	void finished( workerPool::worker * ) ;
+	void stopIdleWorkers() ;
+	void writeScript() ;
+	std::vector< std::unique_ptr< workerPool::worker > > m_workers ;
+	std::map< QString,bool > m_zipApps ;
+	QStringList m_broken ;
+	QTimer m_timer ;
+	QElapsedTimer m_clock ;
+	QString m_script ;
+	engines& m_engines ;
+	Logger& m_logger ;
+	int m_jobId = 0 ;
+} ;
+
+#endif